@@ -0,0 +1,1542 @@
+// SPDX-License-Identifier: MIT
+// btns engine benchmarks on the simulated backend (no hardware needed)
+// ASCII-only comments.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "buttons.h"
+#include "btns_signal.h"
+#include "gpio_mock.h"
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void spin_ns(uint64_t ns)
+{
+    uint64_t end = now_ns() + ns;
+    while (now_ns() < end) {}
+}
+
+static unsigned long opt_ul(int argc, char **argv, const char *name, unsigned long def)
+{
+    for (int i = 2; i + 1 < argc; i++)
+        if (!strcmp(argv[i], name)) return strtoul(argv[i + 1], NULL, 10);
+    return def;
+}
+
+static const char *opt_str(int argc, char **argv, const char *name, const char *def)
+{
+    for (int i = 2; i + 1 < argc; i++)
+        if (!strcmp(argv[i], name)) return argv[i + 1];
+    return def;
+}
+
+// ---------- hardware counters (--perf) ----------
+// perf_event_open counters on the calling thread, user space only: enabled
+// around a measured loop and reported per event next to the ns figures.
+// Only meaningful for the single-threaded modes (engine in no_threads mode or
+// no engine at all). No PMU, perf_event_paranoid > 2 or a seccomp filter just
+// turns them off with a one-line note.
+enum { PC_CYCLES, PC_INSTR, PC_CACHE_MISS, PC_BRANCH_MISS, PC_N };
+
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} PC_EVENTS[PC_N] = {
+    { "cyc",      PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "ins",      PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "llc-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "br-miss",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+static struct {
+    bool on;
+    int fd[PC_N];
+    double v[PC_N];      // last perf_stop(), scaled for multiplexing; <0 = n/a
+} pc;
+
+static void perf_open(void)
+{
+    int first_err = 0;
+    for (int i = 0; i < PC_N; i++) {
+        struct perf_event_attr at;
+        memset(&at, 0, sizeof(at));
+        at.size = sizeof(at);
+        at.type = PC_EVENTS[i].type;
+        at.config = PC_EVENTS[i].config;
+        at.disabled = 1;
+        at.exclude_kernel = 1;
+        at.exclude_hv = 1;
+        at.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        pc.fd[i] = (int)syscall(SYS_perf_event_open, &at, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (pc.fd[i] < 0 && !first_err) first_err = errno;
+    }
+    pc.on = pc.fd[PC_CYCLES] >= 0 || pc.fd[PC_INSTR] >= 0;
+    if (!pc.on)
+        fprintf(stderr, "perf: hardware counters unavailable (%s), skipping\n", strerror(first_err));
+}
+
+static void perf_start(void)
+{
+    if (!pc.on) return;
+    for (int i = 0; i < PC_N; i++) {
+        if (pc.fd[i] < 0) continue;
+        ioctl(pc.fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc.fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static void perf_stop(void)
+{
+    if (!pc.on) return;
+    for (int i = 0; i < PC_N; i++) {
+        uint64_t r[3];   // value, time_enabled, time_running
+        pc.v[i] = -1.0;
+        if (pc.fd[i] < 0) continue;
+        ioctl(pc.fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(pc.fd[i], r, sizeof(r)) != (ssize_t)sizeof(r) || r[2] == 0) continue;
+        pc.v[i] = (double)r[0] * ((double)r[1] / (double)r[2]);
+    }
+}
+
+// "  perf <label>: 812.0 cyc 1650.3 ins (2.03 IPC) 0.02 llc-miss 1.10 br-miss /edge"
+static void perf_report(const char *label, double events, const char *unit)
+{
+    if (!pc.on || events <= 0) return;
+    printf("  perf %s:", label);
+    for (int i = 0; i < PC_N; i++) {
+        if (pc.v[i] < 0) printf(" - %s", PC_EVENTS[i].name);
+        else printf(" %.*f %s", i >= PC_CACHE_MISS ? 3 : 1, pc.v[i] / events, PC_EVENTS[i].name);
+        if (i == PC_INSTR && pc.v[PC_CYCLES] > 0 && pc.v[PC_INSTR] >= 0)
+            printf(" (%.2f IPC)", pc.v[PC_INSTR] / pc.v[PC_CYCLES]);
+    }
+    printf(" /%s\n", unit);
+}
+
+// ---------- prio: critical lane latency under a saturated normal lane ----------
+struct prio_bench {
+    uint64_t cb_ns;   // simulated application work per callback
+};
+
+static void prio_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)evt; (void)index; (void)gpio;
+    struct prio_bench *pb = (struct prio_bench *)user;
+    spin_ns(pb->cb_ns);
+}
+
+static void print_lane(const char *name, const btns_lane_stats_t *s)
+{
+    printf("%-9s %10llu %9llu %10.1f %10.1f\n", name,
+           (unsigned long long)s->dispatched, (unsigned long long)s->dropped,
+           s->dispatched ? (double)s->latency_sum_ns / (double)s->dispatched / 1000.0 : 0.0,
+           (double)s->latency_max_ns / 1000.0);
+}
+
+static int bench_prio(int argc, char **argv)
+{
+    unsigned normal        = (unsigned)opt_ul(argc, argv, "--normal", 8);
+    unsigned long dur_ms   = opt_ul(argc, argv, "--duration-ms", 2000);
+    unsigned long burst    = opt_ul(argc, argv, "--burst", 64);
+    unsigned long gap_us   = opt_ul(argc, argv, "--burst-gap-us", 500);
+    unsigned long cb_us    = opt_ul(argc, argv, "--cb-us", 20);
+    unsigned long crit_us  = opt_ul(argc, argv, "--crit-period-us", 1000);
+    if (normal == 0 || normal > 512) { fprintf(stderr, "--normal 1..512\n"); return 2; }
+
+    enum { CRIT_GPIO = 10, NORMAL_BASE = 100 };
+    btn_pin_t *pins = calloc(normal + 1, sizeof(*pins));
+    if (!pins) return 1;
+    pins[0] = (btn_pin_t){ .gpio = CRIT_GPIO, .active_low = true, .enable_pull = true,
+                           .priority = BTN_PRIO_CRITICAL };
+    for (unsigned i = 0; i < normal; i++)
+        pins[i + 1] = (btn_pin_t){ .gpio = NORMAL_BASE + i, .active_low = true, .enable_pull = true };
+
+    struct prio_bench pb = { .cb_ns = (uint64_t)cb_us * 1000ull };
+    btns_config_t cfg = {
+        .pins = pins, .count = normal + 1,
+        .debounce_ms = 0, .hold_ms = 100000, .repeat_ms = 0,
+        .user = &pb, .on_event = prio_on_event,
+    };
+    btns_ctx_t *ctx = btns_create(&cfg);
+    if (!ctx) { fprintf(stderr, "btns_create failed\n"); free(pins); return 1; }
+
+    // Normal lane: bursts of edges faster than callbacks can drain them
+    // (edge-storm arrival, injector sleeps between bursts like an IRQ source).
+    // Critical button: toggled every crit_us microseconds.
+    uint64_t t0 = now_ns(), next_crit = t0, end = t0 + (uint64_t)dur_ms * 1000000ull;
+    unsigned long events = 0;
+    int crit_level = 1;
+    while (now_ns() < end) {
+        for (unsigned long k = 0; k < burst; k++, events++) {
+            unsigned g = NORMAL_BASE + (unsigned)(events % normal);
+            gpio_mock_set_level(g, !gpio_mock_get_level(g));
+        }
+        if (now_ns() >= next_crit) {
+            crit_level = !crit_level;
+            gpio_mock_set_level(CRIT_GPIO, crit_level);
+            next_crit += (uint64_t)crit_us * 1000ull;
+        }
+        usleep((useconds_t)gap_us);
+    }
+    double secs = (double)(now_ns() - t0) / 1e9;
+    usleep(200000); // let the dispatcher drain
+
+    btns_lane_stats_t crit, norm;
+    btns_get_lane_stats(ctx, BTN_PRIO_CRITICAL, &crit);
+    btns_get_lane_stats(ctx, BTN_PRIO_NORMAL, &norm);
+    btns_destroy(ctx);
+    free(pins);
+
+    printf("prio: normal_buttons=%u injected_edges=%lu in %.3fs (%.0f/s, service %.0f/s) cb=%luus\n",
+           normal, events, secs, (double)events / secs,
+           cb_us ? 1e6 / (double)cb_us : 0.0, cb_us);
+    printf("%-9s %10s %9s %10s %10s\n", "lane", "dispatched", "dropped", "mean_us", "max_us");
+    print_lane("critical", &crit);
+    print_lane("normal", &norm);
+    printf("prio: critical bound = one in-flight callback (%luus) + dispatch overhead\n", cb_us);
+    return 0;
+}
+
+// ---------- vdebounce: bit-sliced vs per-line debounce on sampled inputs ----------
+static uint64_t xorshift64(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *s = x;
+}
+
+// Bouncy sample stream: each input has a true level that flips now and then,
+// and every sample bit disagrees with it with probability 1/8.
+static uint64_t *make_frames(unsigned nbits, unsigned frames, uint64_t seed)
+{
+    unsigned words = (nbits + 63) / 64;
+    uint64_t *f = calloc((size_t)frames * words, sizeof(uint64_t));
+    uint64_t *truth = calloc(words, sizeof(uint64_t));
+    if (!f || !truth) { free(f); free(truth); return NULL; }
+    for (unsigned fr = 0; fr < frames; fr++) {
+        for (unsigned w = 0; w < words; w++) {
+            if ((fr & 127) == 0) truth[w] ^= xorshift64(&seed) & xorshift64(&seed);
+            uint64_t noise = xorshift64(&seed) & xorshift64(&seed) & xorshift64(&seed);
+            f[(size_t)fr * words + w] = truth[w] ^ noise;
+        }
+    }
+    free(truth);
+    return f;
+}
+
+struct line_db {
+    uint8_t state;
+    uint8_t cnt;
+};
+
+static unsigned perline_update(struct line_db *db, unsigned nbits, unsigned samples, const uint64_t *raw)
+{
+    unsigned toggled = 0;
+    for (unsigned i = 0; i < nbits; i++) {
+        uint8_t s = (uint8_t)((raw[i / 64] >> (i % 64)) & 1u);
+        if (s != db[i].state) {
+            if (++db[i].cnt >= samples) { db[i].state = s; db[i].cnt = 0; toggled++; }
+        } else {
+            db[i].cnt = 0;
+        }
+    }
+    return toggled;
+}
+
+static int bench_vdebounce(int argc, char **argv)
+{
+    unsigned samples = (unsigned)opt_ul(argc, argv, "--samples", 4);
+    unsigned frames  = (unsigned)opt_ul(argc, argv, "--frames", 4096);
+    unsigned rounds  = (unsigned)opt_ul(argc, argv, "--rounds", 50);
+    static const unsigned SIZES[] = { 64, 256, 1024 };
+
+    printf("vdebounce: samples=%u frames=%u rounds=%u\n", samples, frames, rounds);
+    printf("%6s %14s %14s %9s %9s\n", "inputs", "perline_ns/smp", "vcount_ns/smp", "speedup", "toggles");
+    for (size_t si = 0; si < sizeof(SIZES) / sizeof(SIZES[0]); si++) {
+        unsigned n = SIZES[si], words = (n + 63) / 64;
+        uint64_t *f = make_frames(n, frames, 0x9e3779b97f4a7c15ull + n);
+        struct line_db *db = calloc(n, sizeof(*db));
+        btns_vdebounce_t *vd = btns_vdebounce_create(n, samples);
+        uint64_t *changed = calloc(words, sizeof(uint64_t));
+        if (!f || !db || !vd || !changed) { fprintf(stderr, "alloc failed\n"); return 1; }
+
+        unsigned long t_pl = 0, t_vc = 0;
+        double pc_pl[PC_N];
+        perf_start();
+        uint64_t a = now_ns();
+        for (unsigned r = 0; r < rounds; r++)
+            for (unsigned fr = 0; fr < frames; fr++)
+                t_pl += perline_update(db, n, samples, &f[(size_t)fr * words]);
+        uint64_t b = now_ns();
+        perf_stop();
+        memcpy(pc_pl, pc.v, sizeof(pc_pl));
+        perf_start();
+        for (unsigned r = 0; r < rounds; r++)
+            for (unsigned fr = 0; fr < frames; fr++)
+                t_vc += btns_vdebounce_update(vd, &f[(size_t)fr * words], changed);
+        uint64_t c = now_ns();
+        perf_stop();
+
+        if (t_pl != t_vc) fprintf(stderr, "vdebounce: MISMATCH at %u inputs (%lu vs %lu)\n", n, t_pl, t_vc);
+        double smp = (double)rounds * frames;
+        double pl = (double)(b - a) / smp, vc = (double)(c - b) / smp;
+        printf("%6u %14.1f %14.1f %8.1fx %9lu\n", n, pl, vc, vc > 0 ? pl / vc : 0.0, t_vc);
+        perf_report("vcount", smp, "smp");
+        memcpy(pc.v, pc_pl, sizeof(pc_pl));
+        perf_report("perline", smp, "smp");
+
+        free(f); free(db); free(changed);
+        btns_vdebounce_destroy(vd);
+    }
+    return 0;
+}
+
+// ---------- scan: snapshot diff + edge extraction per implementation ----------
+static int bench_scan(int argc, char **argv)
+{
+    size_t nbits    = opt_ul(argc, argv, "--inputs", 1u << 20);
+    size_t changes  = opt_ul(argc, argv, "--changes", 256);
+    unsigned frames = (unsigned)opt_ul(argc, argv, "--frames", 64);
+    unsigned rounds = (unsigned)opt_ul(argc, argv, "--rounds", 20);
+    static const char *const IMPL_NAMES[] = { "scalar", "sse2", "avx2", "neon" };
+    if (nbits == 0 || nbits > UINT32_MAX || frames < 2) { fprintf(stderr, "bad --inputs/--frames\n"); return 2; }
+
+    // frames[] snapshots; each differs from the previous one in `changes` random bits
+    size_t words = (nbits + 63) / 64;
+    uint64_t *snap = calloc((size_t)frames * words, sizeof(uint64_t));
+    btns_edge_t *out = calloc(changes + 1, sizeof(*out));
+    btns_edge_t *ref = calloc(changes + 1, sizeof(*ref));
+    if (!snap || !out || !ref) { fprintf(stderr, "alloc failed\n"); return 1; }
+    uint64_t seed = 0x2545f4914f6cdd1dull;
+    for (unsigned fr = 1; fr < frames; fr++) {
+        uint64_t *s = &snap[(size_t)fr * words];
+        memcpy(s, s - words, words * sizeof(uint64_t));
+        for (size_t c = 0; c < changes; c++) {
+            size_t i = xorshift64(&seed) % nbits;
+            s[i / 64] ^= 1ull << (i % 64);
+        }
+    }
+
+    printf("scan: inputs=%zu changes/frame<=%zu frames=%u rounds=%u auto=%s\n",
+           nbits, changes, frames, rounds, btns_scan_impl());
+    printf("%-7s %12s %16s %10s\n", "impl", "ns/frame", "inputs/ms", "edges");
+    for (size_t k = 0; k < sizeof(IMPL_NAMES) / sizeof(IMPL_NAMES[0]); k++) {
+        if (btns_scan_select(IMPL_NAMES[k]) < 0) continue;
+        unsigned long edges = 0, bad = 0;
+        perf_start();
+        uint64_t a = now_ns();
+        for (unsigned r = 0; r < rounds; r++)
+            for (unsigned fr = 1; fr < frames; fr++)
+                edges += btns_scan_edges(&snap[(size_t)(fr - 1) * words], &snap[(size_t)fr * words],
+                                         nbits, out, changes + 1);
+        uint64_t b = now_ns();
+        perf_stop();
+
+        // Cross-check against the scalar path frame by frame
+        for (unsigned fr = 1; fr < frames; fr++) {
+            const uint64_t *p = &snap[(size_t)(fr - 1) * words], *c = &snap[(size_t)fr * words];
+            size_t n = btns_scan_edges(p, c, nbits, out, changes + 1);
+            btns_scan_select("scalar");
+            size_t m = btns_scan_edges(p, c, nbits, ref, changes + 1);
+            btns_scan_select(IMPL_NAMES[k]);
+            if (n != m || memcmp(out, ref, n * sizeof(*out))) bad++;
+        }
+        if (bad) fprintf(stderr, "scan: %s MISMATCH in %lu frames\n", IMPL_NAMES[k], bad);
+
+        double per = (double)(b - a) / ((double)rounds * (frames - 1));
+        printf("%-7s %12.0f %16.0f %10lu\n", IMPL_NAMES[k], per,
+               per > 0 ? (double)nbits * 1e6 / per : 0.0, edges);
+        perf_report(IMPL_NAMES[k], (double)rounds * (frames - 1), "frame");
+    }
+    btns_scan_select(NULL);
+    free(snap); free(out); free(ref);
+    return 0;
+}
+
+// ---------- threads: worker thread vs caller-driven btns_process() ----------
+struct thr_bench {
+    unsigned long events;
+    uint64_t t_set;        // level change injected
+    uint64_t lat_sum, lat_max;
+};
+
+static void thr_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)index; (void)gpio;
+    struct thr_bench *tb = (struct thr_bench *)user;
+    tb->events++;
+    if (evt == BTN_EVENT_PRESS) {
+        uint64_t lat = now_ns() - tb->t_set;
+        tb->lat_sum += lat;
+        if (lat > tb->lat_max) tb->lat_max = lat;
+    }
+}
+
+static long ctx_switches(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+static int bench_threads(int argc, char **argv)
+{
+    unsigned long presses = opt_ul(argc, argv, "--presses", 200);
+    unsigned long hold_ms = opt_ul(argc, argv, "--hold-ms", 30);
+    enum { GPIO = 20 };
+
+    printf("threads: presses=%lu hold=%lums (HOLD at 20ms, REPEAT every 5ms)\n", presses, hold_ms);
+    printf("%-10s %8s %9s %12s %12s\n", "mode", "events", "ctxsw", "press_mean_us", "press_max_us");
+    for (int single = 0; single <= 1; single++) {
+        btn_pin_t pin = { .gpio = GPIO, .active_low = true, .enable_pull = true };
+        struct thr_bench tb = { 0 };
+        btns_config_t cfg = {
+            .pins = &pin, .count = 1, .debounce_ms = 0, .hold_ms = 20, .repeat_ms = 5,
+            .user = &tb, .on_event = thr_on_event, .no_threads = single,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); return 1; }
+
+        long cs0 = ctx_switches();
+        for (unsigned long k = 0; k < presses; k++) {
+            tb.t_set = now_ns();
+            gpio_mock_set_level(GPIO, 0);
+            uint64_t up = now_ns() + hold_ms * 1000000ull;
+            if (single) {
+                while (now_ns() < up) {
+                    uint64_t left = (up - now_ns()) / 1000000ull;
+                    btns_process(ctx, (int)left);
+                }
+            } else {
+                usleep((useconds_t)(hold_ms * 1000));
+            }
+            gpio_mock_set_level(GPIO, 1);
+            if (single) btns_process(ctx, 0);
+        }
+        long cs = ctx_switches() - cs0;
+        btns_destroy(ctx);
+
+        printf("%-10s %8lu %9ld %12.1f %12.1f\n", single ? "no_threads" : "worker", tb.events, cs,
+               (double)tb.lat_sum / (double)presses / 1000.0, (double)tb.lat_max / 1000.0);
+    }
+    return 0;
+}
+
+// ---------- timers: wakeups/s vs timer slack with staggered held buttons ----------
+static void count_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)evt; (void)index; (void)gpio;
+    __atomic_fetch_add((unsigned long *)user, 1, __ATOMIC_RELAXED);
+}
+
+static int bench_timers(int argc, char **argv)
+{
+    unsigned held          = (unsigned)opt_ul(argc, argv, "--held", 8);
+    unsigned long dur_ms   = opt_ul(argc, argv, "--duration-ms", 2000);
+    unsigned long repeat   = opt_ul(argc, argv, "--repeat-ms", 50);
+    unsigned long stagger  = opt_ul(argc, argv, "--stagger-ms", 3);
+    static const unsigned SLACKS[] = { 0, 5, 20 };
+    enum { BASE = 200 };
+    if (held == 0 || held > 256) { fprintf(stderr, "--held 1..256\n"); return 2; }
+
+    btn_pin_t *pins = calloc(held, sizeof(*pins));
+    if (!pins) return 1;
+    for (unsigned i = 0; i < held; i++)
+        pins[i] = (btn_pin_t){ .gpio = BASE + i, .active_low = true, .enable_pull = true };
+
+    printf("timers: held=%u repeat=%lums stagger=%lums duration=%lums\n", held, repeat, stagger, dur_ms);
+    printf("%6s %10s %10s %10s %8s\n", "slack", "idle_wk/s", "held_wk/s", "events/s", "late_ms");
+    for (size_t k = 0; k < sizeof(SLACKS) / sizeof(SLACKS[0]); k++) {
+        unsigned long events = 0;
+        btns_config_t cfg = {
+            .pins = pins, .count = held, .debounce_ms = 0, .hold_ms = 100, .repeat_ms = (unsigned)repeat,
+            .timer_slack_ms = SLACKS[k], .user = &events, .on_event = count_on_event,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); free(pins); return 1; }
+
+        btns_timer_stats_t a, i0, b, c;
+        btns_get_timer_stats(ctx, &a);
+        usleep((useconds_t)(dur_ms * 1000 / 2));
+        btns_get_timer_stats(ctx, &i0);
+        for (unsigned i = 0; i < held; i++) {
+            gpio_mock_set_level(BASE + i, 0);
+            usleep((useconds_t)(stagger * 1000));
+        }
+        unsigned long ev0 = __atomic_load_n(&events, __ATOMIC_RELAXED);
+        btns_get_timer_stats(ctx, &b);
+        usleep((useconds_t)(dur_ms * 1000));
+        btns_get_timer_stats(ctx, &c);
+        unsigned long ev = __atomic_load_n(&events, __ATOMIC_RELAXED) - ev0;
+        for (unsigned i = 0; i < held; i++) gpio_mock_set_level(BASE + i, 1);
+        btns_destroy(ctx);
+
+        double idle_s = (double)(i0.uptime_ms - a.uptime_ms) / 1000.0;
+        double held_s = (double)(c.uptime_ms - b.uptime_ms) / 1000.0;
+        printf("%6u %10.1f %10.1f %10.1f %8u\n", SLACKS[k],
+               idle_s > 0 ? (double)(i0.wakeups - a.wakeups) / idle_s : 0.0,
+               held_s > 0 ? (double)(c.wakeups - b.wakeups) / held_s : 0.0,
+               held_s > 0 ? (double)ev / held_s : 0.0, c.late_max_ms);
+    }
+    free(pins);
+    return 0;
+}
+
+// ---------- turbo: autofire pair timing from the engine timer ----------
+// Phase error = |toggle time - (press + k * half period)|: jitter plus drift.
+// A toggle more than half a period behind schedule means a pair was lost
+// (counted in "lost", k moves on). Baseline: an app-side loop sleeping half
+// a period between toggles, as a naive application timer would.
+struct turbo_bench {
+    uint64_t t0[256];          // press of each button, ms-aligned like the engine's schedule
+    unsigned long k[256];
+    uint64_t half_ns;
+    uint64_t err_max, err_sum;
+    unsigned long n, lost;
+    volatile int measuring;
+};
+
+static void turbo_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)gpio;
+    struct turbo_bench *tb = (struct turbo_bench *)user;
+    if (index >= 256 || !tb->measuring || (evt != BTN_EVENT_PRESS && evt != BTN_EVENT_RELEASE)) return;
+    uint64_t t = now_ns();
+    if (!tb->t0[index]) { tb->t0[index] = t - t % 1000000ull; return; }
+    uint64_t want = tb->t0[index] + ++tb->k[index] * tb->half_ns;
+    while (t > want + tb->half_ns) {
+        want += 2 * tb->half_ns;
+        tb->k[index] += 2;
+        tb->lost++;
+    }
+    uint64_t err = t > want ? t - want : want - t;
+    if (err > tb->err_max) tb->err_max = err;
+    tb->err_sum += err;
+    tb->n++;
+}
+
+static void print_turbo(const char *name, const struct turbo_bench *tb, double secs)
+{
+    printf("%-8s %10lu %10.1f %8lu %12.1f %12.1f\n", name, tb->n, secs > 0 ? (double)tb->n / secs : 0.0,
+           tb->lost, tb->n ? (double)tb->err_sum / (double)tb->n / 1000.0 : 0.0,
+           (double)tb->err_max / 1000.0);
+}
+
+static int bench_turbo(int argc, char **argv)
+{
+    unsigned held        = (unsigned)opt_ul(argc, argv, "--held", 4);
+    unsigned long dur_ms = opt_ul(argc, argv, "--duration-ms", 2000);
+    unsigned period      = (unsigned)opt_ul(argc, argv, "--period-ms", 20);
+    enum { BASE = 300 };
+    if (held == 0 || held > 256 || period < 2) { fprintf(stderr, "--held 1..256, --period-ms >= 2\n"); return 2; }
+
+    btn_pin_t *pins = calloc(held, sizeof(*pins));
+    struct turbo_bench *tb = calloc(1, sizeof(*tb));
+    if (!pins || !tb) return 1;
+    for (unsigned i = 0; i < held; i++)
+        pins[i] = (btn_pin_t){ .gpio = BASE + i, .active_low = true, .enable_pull = true, .turbo_ms = period };
+    tb->half_ns = (uint64_t)period * 500000ull;   // exact for odd periods too
+
+    printf("turbo: held=%u period=%ums duration=%lums\n", held, period, dur_ms);
+    printf("%-8s %10s %10s %8s %12s %12s\n", "source", "toggles", "toggles/s", "lost", "phase_err_us", "max_err_us");
+
+    btns_config_t cfg = {
+        .pins = pins, .count = held, .debounce_ms = 0, .hold_ms = 500,
+        .user = tb, .on_event = turbo_on_event,
+    };
+    btns_ctx_t *ctx = btns_create(&cfg);
+    if (!ctx) { fprintf(stderr, "btns_create failed\n"); free(pins); free(tb); return 1; }
+    tb->measuring = 1;
+    for (unsigned i = 0; i < held; i++) gpio_mock_set_level(BASE + i, 0);
+    usleep((useconds_t)(dur_ms * 1000));
+    tb->measuring = 0;
+    for (unsigned i = 0; i < held; i++) gpio_mock_set_level(BASE + i, 1);
+    btns_destroy(ctx);
+    print_turbo("engine", tb, (double)dur_ms / 1000.0);
+
+    // Baseline: one button, app thread toggling with relative sleeps
+    uint64_t half = tb->half_ns;
+    memset(tb, 0, sizeof(*tb));
+    tb->half_ns = half;
+    tb->measuring = 1;
+    uint64_t end = now_ns() + dur_ms * 1000000ull;
+    turbo_on_event(tb, BTN_EVENT_PRESS, 0, 0);
+    for (int up = 1; now_ns() < end; up = !up) {
+        struct timespec ts = { (time_t)(half / 1000000000ull), (long)(half % 1000000000ull) };
+        nanosleep(&ts, NULL);
+        spin_ns(20000);   // callback work between the wakeup and re-arming
+        turbo_on_event(tb, up ? BTN_EVENT_RELEASE : BTN_EVENT_PRESS, 0, 0);
+    }
+    print_turbo("app", tb, (double)dur_ms / 1000.0);
+
+    free(pins);
+    free(tb);
+    return 0;
+}
+
+// ---------- frame: frame-aligned delivery with an eventfd vsync stand-in ----------
+struct vsync {
+    int fd;
+    unsigned long period_us;
+    volatile int run;
+    pthread_t th;
+};
+
+static void *vsync_thread(void *arg)
+{
+    struct vsync *v = (struct vsync *)arg;
+    uint64_t one = 1;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (v->run) {
+        if (!v->period_us) { usleep(1000); continue; }
+        // absolute deadlines: a tick that wakes late doesn't push the rest
+        next.tv_nsec += (long)(v->period_us * 1000ul);
+        while (next.tv_nsec >= 1000000000L) { next.tv_nsec -= 1000000000L; next.tv_sec++; }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (write(v->fd, &one, sizeof(one)) < 0) break;
+    }
+    return NULL;
+}
+
+// Per-button order check: each toggle pair must arrive as PRESS, RELEASE,
+// CLICK (hold_ms is out of reach), whatever the batching.
+struct frame_rec {
+    unsigned long events, bad;
+    unsigned char next[16];    // 0 = PRESS, 1 = RELEASE, 2 = CLICK
+};
+
+static void frame_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    struct frame_rec *fr = (struct frame_rec *)user;
+    (void)gpio;
+    static const btn_event_t SEQ[3] = { BTN_EVENT_PRESS, BTN_EVENT_RELEASE, BTN_EVENT_CLICK };
+    fr->events++;
+    if (index >= 16 || evt != SEQ[fr->next[index]]) { fr->bad++; return; }
+    fr->next[index] = (unsigned char)((fr->next[index] + 1) % 3);
+}
+
+static int bench_frame(int argc, char **argv)
+{
+    unsigned long dur_ms  = opt_ul(argc, argv, "--duration-ms", 1000);
+    unsigned long rate    = opt_ul(argc, argv, "--rate", 2000);          // edges/s
+    unsigned long frame_us = opt_ul(argc, argv, "--frame-us", 16667);
+    unsigned long hb_ms   = opt_ul(argc, argv, "--holdback-ms", 8);
+    unsigned long slack_us = opt_ul(argc, argv, "--slack-us", 5000);    // scheduling latency allowed
+    enum { GPIO = 300, NBTN = 16 };
+
+    btn_pin_t pins[NBTN];
+    for (unsigned i = 0; i < NBTN; i++)
+        pins[i] = (btn_pin_t){ .gpio = GPIO + i, .active_low = true, .enable_pull = true };
+
+    // Rows: immediate delivery, frames with/without a hold-back bound, and a
+    // stalled vsync (no ticks) where only the bound delivers.
+    struct { const char *name; bool sync; unsigned long hb; unsigned long period; } runs[] = {
+        { "immediate", false, 0,     frame_us },
+        { "frame",     true,  0,     frame_us },
+        { "frame+hb",  true,  hb_ms, frame_us },
+        { "stalled+hb", true, hb_ms, 0 },
+    };
+    printf("frame: rate=%lu/s frame=%luus holdback=%lums duration=%lums\n", rate, frame_us, hb_ms, dur_ms);
+    printf("%-11s %8s %10s %10s %12s %10s\n", "mode", "events", "batches/s", "ev/batch", "lat_max_us", "hb_flush");
+    int fail = 0;
+    for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+        struct frame_rec rec;
+        memset(&rec, 0, sizeof(rec));
+        for (unsigned i = 0; i < NBTN; i++) gpio_mock_set_level(GPIO + i, 1);
+        struct vsync v = { .fd = eventfd(0, EFD_CLOEXEC), .period_us = runs[r].period, .run = 1 };
+        if (v.fd < 0) { perror("eventfd"); return 1; }
+        btns_config_t cfg = {
+            .pins = pins, .count = NBTN, .debounce_ms = 0, .hold_ms = 100000,
+            .user = &rec, .on_event = frame_on_event,
+            .frame_sync = runs[r].sync, .frame_fd = v.fd, .frame_holdback_ms = (unsigned)runs[r].hb,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); return 1; }
+        pthread_create(&v.th, NULL, vsync_thread, &v);
+
+        uint64_t t0 = now_ns(), end = t0 + dur_ms * 1000000ull, gap = 1000000000ull / (rate ? rate : 1);
+        unsigned long k = 0;
+        for (uint64_t next = t0; next < end; next += gap, k++) {
+            while (now_ns() < next) usleep(50);
+            unsigned g = GPIO + (unsigned)(k % NBTN);
+            gpio_mock_set_level(g, !gpio_mock_get_level(g));
+        }
+        usleep(100000);
+        double secs = (double)(now_ns() - t0) / 1e9;
+
+        btns_frame_stats_t fs;
+        bool have = btns_get_frame_stats(ctx, &fs) == 0;
+        v.run = 0;
+        pthread_join(v.th, NULL);
+        btns_destroy(ctx);
+        close(v.fd);
+
+        // k toggles round-robin: button i saw k/NBTN (+1) of them, odd ones
+        // press (1 event), even ones release (RELEASE + CLICK)
+        unsigned long want = 0;
+        for (unsigned i = 0; i < NBTN; i++) {
+            unsigned long t = k / NBTN + (i < k % NBTN);
+            want += (t + 1) / 2 + 2 * (t / 2);
+        }
+        unsigned long ev = rec.events;
+        if (ev != want || rec.bad) {
+            fprintf(stderr, "frame: %s MISMATCH (%lu events, want %lu, %lu out of order)\n",
+                    runs[r].name, ev, want, rec.bad);
+            fail = 1;
+        }
+        // Latency bound: the hold-back where there is one, else one frame,
+        // plus the scheduling slack. Timing depends on the host, so a miss
+        // is a warning; a stalled vsync without hold-back flushes means the
+        // bound never fired, and fails.
+        uint64_t bound_us = (runs[r].hb ? runs[r].hb * 1000ul : frame_us) + slack_us;
+        if (have && runs[r].sync && fs.latency_max_ns > bound_us * 1000ull)
+            fprintf(stderr, "frame: warning: %s lat_max %.1fus over %s + slack (%luus)\n",
+                    runs[r].name, (double)fs.latency_max_ns / 1000.0,
+                    runs[r].hb ? "holdback" : "1 frame", bound_us);
+        if (have && runs[r].hb && !runs[r].period && ev && !fs.holdback_flushes) {
+            fprintf(stderr, "frame: %s delivered nothing through the hold-back bound\n", runs[r].name);
+            fail = 1;
+        }
+        double batches = have ? (double)(fs.frames + fs.holdback_flushes) : (double)ev;
+        printf("%-11s %8lu %10.1f %10.1f %12.1f %10llu\n", runs[r].name, ev, batches / secs,
+               batches > 0 ? (double)ev / batches : 0.0,
+               have ? (double)fs.latency_max_ns / 1000.0 : 0.0,
+               have ? (unsigned long long)fs.holdback_flushes : 0ull);
+    }
+    return fail;
+}
+
+// ---------- analog: rapid trigger vs fixed actuation point on Hall-effect travel ----------
+// Synthetic 12-bit travel per key: full strokes mixed with partial lifts and
+// re-presses (what rapid trigger is for), plus sample noise. The stream is
+// written in the IIO buffer layout (s16 LE per key + s64 timestamp) and read
+// back through btns_iio, so the reader is part of the measured path.
+#define AN_REST   2048
+#define AN_BOTTOM 3800
+
+struct an_key {
+    int pos, target, speed;    // travel 0..1000, units per scan
+    unsigned dwell;
+    unsigned long stroke_at;   // scan the current press stroke started (0 = none)
+};
+
+struct an_score {
+    unsigned long presses, lat_scans;
+    bool down;
+};
+
+static void an_next_target(struct an_key *k, unsigned long scan, uint64_t *seed, unsigned long *intents)
+{
+    uint64_t r = xorshift64(seed);
+    if (k->target > 0 && k->pos >= k->target && k->speed > 0) {
+        // bottom of a stroke: full release or partial lift
+        k->target = (r & 1) ? 0 : k->pos - 120 - (int)((r >> 8) % 200);
+        if (k->target < 0) k->target = 0;
+        k->speed = -(20 + (int)((r >> 20) % 40));
+        k->stroke_at = 0;
+    } else {
+        // top: wait, then press again (from wherever the lift stopped)
+        k->dwell = 5 + (unsigned)(r >> 4) % 60;
+        k->target = k->pos + 150 + (int)((r >> 12) % 700);
+        if (k->target > 1000) k->target = 1000;
+        k->speed = 20 + (int)((r >> 24) % 40);
+        k->stroke_at = scan + k->dwell;   // motion starts after the dwell
+        (*intents)++;
+    }
+}
+
+static void an_score(struct an_score *sc, const struct an_key *k, bool down, unsigned long scan)
+{
+    if (down == sc->down) return;
+    sc->down = down;
+    if (!down) return;
+    sc->presses++;
+    if (k->stroke_at) sc->lat_scans += scan - k->stroke_at;
+}
+
+static void an_step(struct an_key *q, unsigned long scan, uint64_t *seed, unsigned long *intents)
+{
+    if (q->dwell) q->dwell--;
+    else if ((q->speed > 0 && q->pos >= q->target) || (q->speed <= 0 && q->pos <= q->target))
+        an_next_target(q, scan, seed, intents);
+    else {
+        q->pos += q->speed;
+        if (q->pos > 1000) q->pos = 1000;
+        if (q->pos < 0) q->pos = 0;
+    }
+}
+
+static int bench_analog(int argc, char **argv)
+{
+    unsigned keys  = (unsigned)opt_ul(argc, argv, "--keys", 16);
+    unsigned long scans = opt_ul(argc, argv, "--scans", 200000);
+    unsigned noise = (unsigned)opt_ul(argc, argv, "--noise", 12);
+    unsigned delta = (unsigned)opt_ul(argc, argv, "--delta", 50);
+    unsigned act   = (unsigned)opt_ul(argc, argv, "--actuation", 500);
+    const char *out = opt_str(argc, argv, "--out", NULL);
+    if (keys == 0 || keys > 64 || act < 50 || act > 1000) {
+        fprintf(stderr, "bad --keys (1..64) / --actuation (50..1000)\n");
+        return 2;
+    }
+
+    char tmpl[] = "/tmp/btns-iio-XXXXXX";
+    int fd = out ? open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644) : mkstemp(tmpl);
+    if (fd < 0) { perror("analog: output"); return 1; }
+    const char *path = out ? out : tmpl;
+    FILE *f = fdopen(fd, "wb");
+
+    btns_analog_key_t cfg[64];
+    for (unsigned i = 0; i < keys; i++)
+        cfg[i] = (btns_analog_key_t){ AN_REST, AN_BOTTOM, 100, (uint16_t)delta, (uint16_t)delta };
+    btns_analog_t *an = btns_analog_create(cfg, keys);
+    size_t scan_bytes = (((size_t)keys * 2 + 7) & ~(size_t)7) + 8;
+    uint8_t *buf = calloc(1, scan_bytes);
+    struct an_key *k = calloc(keys, sizeof(*k));
+    if (!f || !an || !buf || !k) { fprintf(stderr, "alloc failed\n"); return 1; }
+
+    // 1) synthesize the stream and score both actuation models against the
+    //    generator's stroke starts
+    struct an_score rt[64], fx[64];
+    memset(rt, 0, sizeof(rt));
+    memset(fx, 0, sizeof(fx));
+    bool fixed[64] = { false };
+    int32_t row[64];
+    uint64_t st[1];
+    uint64_t seed = 0x853c49e6748fea9bull;
+    unsigned long intents = 0, rt_toggles = 0;
+    for (unsigned long s = 1; s <= scans; s++) {
+        for (unsigned i = 0; i < keys; i++) {
+            an_step(&k[i], s, &seed, &intents);
+            row[i] = AN_REST + k[i].pos * (AN_BOTTOM - AN_REST) / 1000;
+            row[i] += (int)(xorshift64(&seed) % (2 * noise + 1)) - (int)noise;
+            buf[i * 2] = (uint8_t)row[i];
+            buf[i * 2 + 1] = (uint8_t)(row[i] >> 8);
+        }
+        uint64_t ts = s * 1000000ull;   // 1 kHz scan clock
+        memcpy(buf + scan_bytes - 8, &ts, 8);
+        fwrite(buf, 1, scan_bytes, f);
+
+        rt_toggles += btns_analog_update(an, row, NULL);
+        btns_analog_state(an, st);
+        for (unsigned i = 0; i < keys; i++) {
+            an_score(&rt[i], &k[i], (st[0] >> i) & 1, s);
+            long t = ((long)row[i] - AN_REST) * 1000 / (AN_BOTTOM - AN_REST);
+            fixed[i] = fixed[i] ? t > (long)act - 50 : t >= (long)act;   // 5% hysteresis
+            an_score(&fx[i], &k[i], fixed[i], s);
+        }
+    }
+    fclose(f);
+    btns_analog_destroy(an);
+
+    // 2) read it back through the IIO reader: per-scan cost of read + update
+    an = btns_analog_create(cfg, keys);
+    btns_iio_t *io = btns_iio_open(path, keys, 2, true);
+    if (!an || !io) { perror("analog: open"); return 1; }
+    static int32_t raw[64 * 64];
+    uint64_t changed[1];
+    unsigned long got = 0, rb_toggles = 0;
+    int n;
+    perf_start();
+    uint64_t a = now_ns();
+    while ((n = btns_iio_read(io, raw, 64)) > 0) {
+        for (int s = 0; s < n; s++) rb_toggles += btns_analog_update(an, &raw[(size_t)s * keys], changed);
+        got += (unsigned long)n;
+    }
+    uint64_t b = now_ns();
+    perf_stop();
+    if (n != -ENODATA) fprintf(stderr, "analog: read error %d\n", n);
+    if (got != scans || rb_toggles != rt_toggles)
+        fprintf(stderr, "analog: MISMATCH read back %lu/%lu scans, %lu/%lu toggles\n",
+                got, scans, rb_toggles, rt_toggles);
+    btns_iio_close(io);
+
+    unsigned long rp = 0, rl = 0, fp = 0, fl = 0;
+    for (unsigned i = 0; i < keys; i++) {
+        rp += rt[i].presses; rl += rt[i].lat_scans;
+        fp += fx[i].presses; fl += fx[i].lat_scans;
+    }
+    printf("analog: keys=%u scans=%lu noise=+-%u raw delta=%u actuation=%u file=%s\n",
+           keys, scans, noise, delta, act, out ? out : "(temp)");
+    printf("iio read+update: %.1f ns/scan (%.1f ns/key)\n",
+           got ? (double)(b - a) / got : 0.0, got ? (double)(b - a) / got / keys : 0.0);
+    perf_report("iio", (double)got, "scan");
+    printf("%-14s %9s %9s %14s\n", "mode", "presses", "strokes", "scans_to_press");
+    printf("%-14s %9lu %9lu %14.1f\n", "rapid-trigger", rp, intents, rp ? (double)rl / rp : 0.0);
+    printf("%-14s %9lu %9lu %14.1f\n", "fixed", fp, intents, fp ? (double)fl / fp : 0.0);
+
+    if (!out) unlink(tmpl);
+    btns_analog_destroy(an);
+    free(buf); free(k);
+    return 0;
+}
+
+// ---------- pipeline: injected edges through the keypad-hid stages ----------
+// Same batches through a callback sink (in-process consumer) and the uinput /
+// uhid encoders writing to /dev/null: cost of the event path per edge.
+// --model NAME: a btns_signal stream (--seconds of it) instead of clean
+// chords; edges with the same timestamp form one batch. keys = keys sent,
+// i.e. what bounce and glitches that get past min-gap turn into.
+struct pipe_count {
+    unsigned long keys, frames;
+};
+
+static int pipe_cb_key(void *user, int keycode, bool down)
+{
+    (void)keycode; (void)down;
+    ((struct pipe_count *)user)->keys++;
+    return 0;
+}
+
+static int pipe_cb_flush(void *user)
+{
+    ((struct pipe_count *)user)->frames++;
+    return 0;
+}
+
+static int bench_pipeline(int argc, char **argv)
+{
+    unsigned keys  = (unsigned)opt_ul(argc, argv, "--keys", 8);
+    unsigned chord = (unsigned)opt_ul(argc, argv, "--chord", 2);
+    unsigned long cycles = opt_ul(argc, argv, "--cycles", 500000);
+    const char *model = opt_str(argc, argv, "--model", NULL);
+    unsigned min_gap = (unsigned)opt_ul(argc, argv, "--min-gap-ms", 0);
+    if (keys == 0 || keys > 64 || chord == 0 || chord > keys) {
+        fprintf(stderr, "bad --keys (1..64) / --chord (1..keys)\n");
+        return 2;
+    }
+    btns_sig_edge_t *sig = NULL;
+    long nsig = 0;
+    if (model) {
+        btns_signal_model_t m;
+        if (btns_signal_preset(model, &m)) {
+            fprintf(stderr, "unknown --model %s (%s)\n", model, btns_signal_presets());
+            return 2;
+        }
+        nsig = btns_signal_generate(&m, keys, (unsigned)opt_ul(argc, argv, "--seconds", 600) * 1000u, &sig);
+        if (nsig <= 0) { fprintf(stderr, "pipeline: signal: %s\n", strerror(nsig ? (int)-nsig : ENODATA)); return 1; }
+    }
+
+    btns_keymap_t map[64];
+    for (unsigned i = 0; i < keys; i++)
+        map[i] = (btns_keymap_t){ i, 30 + (int)i, -1, 0 };   // KEY_A..: all have HID usages
+
+    if (model) printf("pipeline: keys=%u model=%s edges=%ld min_gap=%ums\n", keys, model, nsig, min_gap);
+    else printf("pipeline: keys=%u chord=%u cycles=%lu min_gap=%ums\n", keys, chord, cycles, min_gap);
+    printf("%-14s %12s %10s %10s %10s\n", "sink", "edges", "keys", "frames", "ns/edge");
+    for (int kind = 0; kind < 3; kind++) {
+        struct pipe_count cnt = { 0, 0 };
+        btns_sink_t *sink = NULL;
+        int rc = kind == 0 ? btns_sink_callback_open(&sink, pipe_cb_key, pipe_cb_flush, &cnt)
+                           : btns_sink_null_open(&sink, kind == 1 ? BTNS_SINK_UINPUT : BTNS_SINK_UHID);
+        if (rc) { fprintf(stderr, "pipeline: sink: %s\n", strerror(-rc)); return 1; }
+        btns_pipe_config_t pc;
+        memset(&pc, 0, sizeof(pc));
+        pc.map = map;
+        pc.map_count = keys;
+        pc.sink = sink;
+        pc.min_gap_ms = min_gap;
+        btns_pipe_t *p = btns_pipe_create(&pc);
+        if (!p) { perror("pipeline: create"); sink->destroy(sink); free(sig); return 1; }
+
+        unsigned base = 0;
+        uint64_t ts = now_ns();
+        perf_start();
+        uint64_t a = now_ns();
+        for (long i = 0; i < nsig && !rc; i++) {
+            rc = btns_pipe_edge(p, sig[i].line, sig[i].level == 0, ts + sig[i].t_us * 1000u);
+            if (!rc && (i + 1 == nsig || sig[i + 1].t_us != sig[i].t_us)) rc = btns_pipe_flush(p);
+        }
+        for (unsigned long c = 0; c < cycles && !model && !rc; c++) {
+            for (int phase = 0; phase < 2 && !rc; phase++) {
+                for (unsigned k = 0; k < chord && !rc; k++)
+                    rc = btns_pipe_edge(p, (base + k) % keys, phase == 0, ts);
+                if (!rc) rc = btns_pipe_flush(p);
+                ts += 1000000;
+            }
+            base = (base + chord) % keys;
+        }
+        uint64_t b = now_ns();
+        perf_stop();
+        if (rc) fprintf(stderr, "pipeline: %s\n", strerror(-rc));
+
+        btns_pipe_stats_t st;
+        btns_pipe_get_stats(p, &st);
+        static const char *const NAMES[] = { "callback", "uinput/null", "uhid/null" };
+        printf("%-14s %12llu %10llu %10llu %10.1f\n", NAMES[kind], (unsigned long long)st.edges,
+               (unsigned long long)st.keys_sent, (unsigned long long)st.frames, st.edges ? (double)(b - a) / (double)st.edges : 0.0);
+        perf_report(NAMES[kind], (double)st.edges, "edge");
+        if (kind == 0 && (cnt.keys != st.keys_sent || cnt.frames != st.frames))
+            fprintf(stderr, "pipeline: MISMATCH callback keys %lu/%llu frames %lu/%llu\n",
+                    cnt.keys, (unsigned long long)st.keys_sent,
+                    cnt.frames, (unsigned long long)st.frames);
+        btns_pipe_destroy(p);
+    }
+    free(sig);
+    return 0;
+}
+
+// ---------- subs: compiled subscriptions vs. filtering in one on_event ----------
+// S consumers, each interested in PRESS/RELEASE of one button. "filter" is
+// the single on_event fanning out and testing every consumer; "compiled"
+// registers them with btns_subscribe().
+#define SUBS_MAX 256
+
+struct subs_consumer {
+    unsigned button;
+    uint32_t events;
+    unsigned long hits;
+};
+
+struct subs_bench {
+    struct subs_consumer c[SUBS_MAX];
+    unsigned n;
+};
+
+static void subs_consumer_fn(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)evt; (void)index; (void)gpio;
+    ((struct subs_consumer *)user)->hits++;
+}
+
+static void subs_filter_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    struct subs_bench *sb = user;
+    for (unsigned i = 0; i < sb->n; i++)
+        if (sb->c[i].button == index && (sb->c[i].events & BTNS_EVT_BIT(evt)))
+            subs_consumer_fn(&sb->c[i], evt, index, gpio);
+}
+
+static int bench_subs(int argc, char **argv)
+{
+    unsigned buttons = (unsigned)opt_ul(argc, argv, "--buttons", 64);
+    unsigned nsubs   = (unsigned)opt_ul(argc, argv, "--subs", 32);
+    unsigned long presses = opt_ul(argc, argv, "--presses", 200000);
+    if (buttons == 0 || buttons > 64 || nsubs == 0 || nsubs > SUBS_MAX) {
+        fprintf(stderr, "bad --buttons (1..64) / --subs (1..%d)\n", SUBS_MAX);
+        return 2;
+    }
+
+    btn_pin_t pins[64];
+    for (unsigned i = 0; i < buttons; i++)
+        pins[i] = (btn_pin_t){ .gpio = 100 + i, .active_low = true, .enable_pull = true };
+
+    printf("subs: buttons=%u subscribers=%u presses=%lu (each subscriber: PRESS|RELEASE of one button)\n",
+           buttons, nsubs, presses);
+    printf("%-10s %12s %10s\n", "mode", "hits", "ns/edge");
+    for (int compiled = 0; compiled <= 1; compiled++) {
+        static struct subs_bench sb;
+        memset(&sb, 0, sizeof(sb));
+        sb.n = nsubs;
+        for (unsigned i = 0; i < nsubs; i++) {
+            sb.c[i].button = i % buttons;
+            sb.c[i].events = BTNS_EVT_BIT(BTN_EVENT_PRESS) | BTNS_EVT_BIT(BTN_EVENT_RELEASE);
+        }
+        btns_config_t cfg = {
+            .pins = pins, .count = buttons, .debounce_ms = 0, .hold_ms = 1000000,
+            .no_threads = true,
+            .user = &sb, .on_event = compiled ? NULL : subs_filter_on_event,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); return 1; }
+        for (unsigned i = 0; compiled && i < nsubs; i++) {
+            uint64_t mask = 1ull << sb.c[i].button;
+            if (btns_subscribe(ctx, &mask, sb.c[i].events, subs_consumer_fn, &sb.c[i]) < 0) {
+                fprintf(stderr, "btns_subscribe failed\n");
+                return 1;
+            }
+        }
+
+        perf_start();
+        uint64_t a = now_ns();
+        for (unsigned long k = 0; k < presses; k++) {
+            unsigned g = 100 + (unsigned)(k % buttons);
+            gpio_mock_set_level(g, 0);
+            gpio_mock_set_level(g, 1);
+            btns_process(ctx, 0);
+        }
+        uint64_t b = now_ns();
+        perf_stop();
+        btns_destroy(ctx);
+
+        unsigned long hits = 0;
+        for (unsigned i = 0; i < nsubs; i++) hits += sb.c[i].hits;
+        printf("%-10s %12lu %10.1f\n", compiled ? "compiled" : "filter", hits,
+               (double)(b - a) / (double)(2 * presses));
+        perf_report(compiled ? "compiled" : "filter", 2.0 * presses, "edge");
+    }
+    return 0;
+}
+
+// ---------- budget: callback timing overhead and overrun detection ----------
+// One on_event doing cb-ns of work, every Nth call stalled by slow-us.
+// Reports the cost of timing every call and what the per-callback stats and
+// BTN_EVENT_OVERRUN events caught.
+struct budget_bench {
+    uint64_t work_ns, slow_ns;
+    unsigned long slow_every, calls, overruns;
+};
+
+static void budget_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)index; (void)gpio;
+    struct budget_bench *bb = user;
+    if (evt == BTN_EVENT_OVERRUN) { bb->overruns++; return; }
+    bb->calls++;
+    spin_ns(bb->slow_every && bb->calls % bb->slow_every == 0 ? bb->slow_ns : bb->work_ns);
+}
+
+static int bench_budget(int argc, char **argv)
+{
+    unsigned long presses = opt_ul(argc, argv, "--presses", 100000);
+    unsigned budget_us = (unsigned)opt_ul(argc, argv, "--budget-us", 200);
+    struct budget_bench proto = {
+        .work_ns = opt_ul(argc, argv, "--cb-ns", 500),
+        .slow_ns = opt_ul(argc, argv, "--slow-us", 2000) * 1000ull,
+        .slow_every = opt_ul(argc, argv, "--slow-every", 5000),
+    };
+    enum { GPIO = 30 };
+
+    printf("budget: presses=%lu cb=%lluns, every %lu-th call %lluus, budget=%uus\n", presses,
+           (unsigned long long)proto.work_ns, proto.slow_every,
+           (unsigned long long)(proto.slow_ns / 1000), budget_us);
+    printf("%-8s %10s %9s %9s %9s %9s %9s %9s\n", "timing", "ns/edge", "calls", "over",
+           "overrun", "p50_ns", "p99_ns", "max_us");
+    for (int timed = 0; timed <= 1; timed++) {
+        struct budget_bench bb = proto;
+        btn_pin_t pin = { .gpio = GPIO, .active_low = true, .enable_pull = true };
+        btns_config_t cfg = {
+            .pins = &pin, .count = 1, .debounce_ms = 0, .hold_ms = 1000000, .no_threads = true,
+            .user = &bb, .on_event = budget_on_event, .cb_budget_us = timed ? budget_us : 0,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); return 1; }
+        perf_start();
+        uint64_t a = now_ns();
+        for (unsigned long k = 0; k < presses; k++) {
+            gpio_mock_set_level(GPIO, 0);
+            gpio_mock_set_level(GPIO, 1);
+            btns_process(ctx, 0);
+        }
+        uint64_t b = now_ns();
+        perf_stop();
+        btns_cb_stats_t st;
+        bool have = btns_get_cb_stats(ctx, BTNS_CB_ON_EVENT, &st) == 0;
+        btns_destroy(ctx);
+
+        // 3 events per press (PRESS, RELEASE, CLICK); slow calls included
+        uint64_t slow = bb.slow_every ? (bb.calls / bb.slow_every) * bb.slow_ns : 0;
+        double per = (double)(b - a - slow) / (double)(3 * presses);
+        if (!have) {
+            printf("%-8s %10.1f %9lu %9s %9s %9s %9s %9s\n", "off", per, bb.calls, "-", "-", "-", "-", "-");
+            perf_report("off", 3.0 * presses, "event");
+            continue;
+        }
+        printf("%-8s %10.1f %9llu %9llu %9lu %9llu %9llu %9.1f\n", "on", per,
+               (unsigned long long)st.calls, (unsigned long long)st.over_budget, bb.overruns,
+               (unsigned long long)btns_cb_stats_percentile(&st, 50.0),
+               (unsigned long long)btns_cb_stats_percentile(&st, 99.0),
+               (double)st.max_ns / 1000.0);
+        perf_report("on", 3.0 * presses, "event");
+    }
+    return 0;
+}
+
+// ---------- shards: sharded edge processing, 1..N threads ----------
+// Many-chip layout (--chips x --lines inputs, group = chip); one injector
+// thread stands in for the backend. Time until every event is delivered.
+struct shard_bench {
+    unsigned long events;   // merge thread (or the injector, unsharded)
+    unsigned long bad;      // per-button order broken
+    uint8_t *last;
+};
+
+static void shard_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)gpio;
+    struct shard_bench *sb = user;
+    uint8_t want = evt == BTN_EVENT_PRESS ? BTN_EVENT_CLICK : evt == BTN_EVENT_RELEASE ? BTN_EVENT_PRESS
+                                                                                       : BTN_EVENT_RELEASE;
+    if (sb->last[index] != want && !(evt == BTN_EVENT_PRESS && sb->last[index] == 0)) sb->bad++;
+    sb->last[index] = (uint8_t)evt;
+    __atomic_store_n(&sb->events, sb->events + 1, __ATOMIC_RELEASE);
+}
+
+static int bench_shards(int argc, char **argv)
+{
+    unsigned chips = (unsigned)opt_ul(argc, argv, "--chips", 8);
+    unsigned lines = (unsigned)opt_ul(argc, argv, "--lines", 50);
+    unsigned maxt  = (unsigned)opt_ul(argc, argv, "--max-shards", 8);
+    unsigned long rounds = opt_ul(argc, argv, "--rounds", 200);
+    unsigned n = chips * lines;
+    if (n == 0 || 100 + n > GPIO_MOCK_MAX_LINES || maxt == 0) {
+        fprintf(stderr, "bad --chips/--lines (max %d inputs) / --max-shards\n", GPIO_MOCK_MAX_LINES - 100);
+        return 2;
+    }
+    btn_pin_t *pins = calloc(n, sizeof(*pins));
+    uint8_t *last = calloc(n, 1);
+    if (!pins || !last) return 1;
+    for (unsigned i = 0; i < n; i++)
+        pins[i] = (btn_pin_t){ .gpio = 100 + i, .active_low = true, .enable_pull = true, .group = i / lines };
+
+    unsigned long edges = 2ul * n * rounds;
+    printf("shards: chips=%u lines/chip=%u inputs=%u rounds=%lu edges=%lu cpus=%ld\n",
+           chips, lines, n, rounds, edges, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-7s %10s %10s %9s %10s %10s %6s\n", "shards", "ns/edge", "Medges/s", "speedup", "in_full", "out_full", "order");
+    double base = 0;
+    for (unsigned t = 1; t <= maxt; t++) {
+        struct shard_bench sb = { 0, 0, last };
+        memset(last, 0, n);
+        btns_config_t cfg = {
+            .pins = pins, .count = n, .debounce_ms = 0, .hold_ms = 1000000,
+            .user = &sb, .on_event = shard_on_event, .shards = t,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); return 1; }
+
+        unsigned long want = 3ul * n * rounds;   // PRESS, RELEASE, CLICK
+        perf_start();
+        uint64_t a = now_ns();
+        for (unsigned long r = 0; r < rounds; r++)
+            for (unsigned i = 0; i < n; i++) {
+                gpio_mock_set_level(100 + i, 0);
+                gpio_mock_set_level(100 + i, 1);
+            }
+        while (__atomic_load_n(&sb.events, __ATOMIC_ACQUIRE) < want && now_ns() - a < 10000000000ull)
+            sched_yield();
+        uint64_t b = now_ns();
+        perf_stop();
+
+        unsigned long long in_full = 0, out_full = 0;
+        btns_shard_stats_t ss;
+        for (unsigned k = 0; btns_get_shard_stats(ctx, k, &ss) == 0; k++) {
+            in_full += ss.in_full;
+            out_full += ss.out_full;
+        }
+        btns_destroy(ctx);
+
+        double per = (double)(b - a) / (double)edges;
+        if (t == 1) base = per;
+        char name[16];
+        snprintf(name, sizeof(name), t == 1 ? "off" : "%u", t);
+        printf("%-7s %10.1f %10.2f %8.2fx %10llu %10llu %6s\n", name, per, per > 0 ? 1e3 / per : 0.0,
+               per > 0 ? base / per : 0.0, in_full, out_full,
+               sb.events != want ? "LOST" : sb.bad ? "BAD" : "ok");
+        perf_report("injector", (double)edges, "edge");
+    }
+    free(pins); free(last);
+    return 0;
+}
+
+// ---------- debounce: kernel vs software vs both on a recorded edge trace ----------
+// Raw edges are replayed in real time into the mock; kernel debounce is the
+// mock's glitch filter emulation (stable for debounce_ms, reported late).
+// Ground truth comes from the trace itself: a level that holds for
+// --stable-ms is a real transition, starting at the first edge of its burst.
+// latency = burst start -> PRESS/RELEASE; false = an event that is not the
+// next expected transition of its line (glitch, bounce); missed = transition
+// without its event. cpu = engine CPU time / events: the alert path (thread
+// CPU inside the mock's alert callbacks, on the replay or filter thread) plus
+// the worker thread; the replay and the emulated kernel filter are left out.
+//
+// --trace FILE: "t_us line level" (raw level, active low) per line, or the
+// stderr of keypad-hid --trace ("trace: <kp> ts=NS off=N level=L <action>",
+// logical level; record it with --debounce-ms 0 to get raw edges).
+// Without --trace a btns_signal model (--model, default "field") is used;
+// --record FILE saves the stream in the first format.
+#define DB_MAX_LINES 64
+#define DB_GPIO      300
+
+struct db_trans {
+    uint64_t start_us;   // first edge of the burst
+    bool     press;
+};
+
+struct db_event {
+    uint64_t t_ns;       // since replay start
+    unsigned line;
+    bool     press;
+};
+
+struct db_bench {
+    uint64_t t0;
+    struct db_event *ev;
+    unsigned long max, n;
+};
+
+static void db_on_event(void *user, btn_event_t evt, unsigned index, unsigned gpio)
+{
+    (void)gpio;
+    struct db_bench *db = user;
+    if (evt != BTN_EVENT_PRESS && evt != BTN_EVENT_RELEASE) return;
+    unsigned long k = __atomic_fetch_add(&db->n, 1, __ATOMIC_RELAXED);
+    if (k < db->max) db->ev[k] = (struct db_event){ now_ns() - db->t0, index, evt == BTN_EVENT_PRESS };
+}
+
+static int db_cmp_lat(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int db_cmp_edge(const void *a, const void *b)
+{
+    const btns_sig_edge_t *x = a, *y = b;
+    return x->t_us < y->t_us ? -1 : x->t_us > y->t_us;
+}
+
+// Line ids of the file are renumbered 0..n-1 in order of appearance
+static long db_load(const char *path, btns_sig_edge_t **out, unsigned *nlines)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "%s: %s\n", path, strerror(errno)); return -1; }
+    unsigned ids[DB_MAX_LINES];
+    size_t n = 0, cap = 0;
+    btns_sig_edge_t *e = NULL;
+    uint64_t base = UINT64_MAX;
+    char buf[256];
+    *nlines = 0;
+    while (fgets(buf, sizeof(buf), f)) {
+        unsigned long long t;
+        unsigned id;
+        int level;
+        char action[32] = "";
+        if (sscanf(buf, "trace: %*s ts=%llu off=%u level=%d %31s", &t, &id, &level, action) >= 3) {
+            if (!strcmp(action, "turbo")) continue;   // autofire, not an input edge
+            t /= 1000u;
+            level = !level;
+        } else if (buf[0] == '#' || sscanf(buf, "%llu %u %d", &t, &id, &level) != 3) {
+            continue;
+        }
+        unsigned k = 0;
+        while (k < *nlines && ids[k] != id) k++;
+        if (k == *nlines) {
+            if (k == DB_MAX_LINES) continue;
+            ids[(*nlines)++] = id;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            btns_sig_edge_t *ne = realloc(e, cap * sizeof(*e));
+            if (!ne) { free(e); fclose(f); return -1; }
+            e = ne;
+        }
+        if (t < base) base = t;
+        e[n++] = (btns_sig_edge_t){ t, k, level != 0, BTNS_SIG_RAW };
+    }
+    fclose(f);
+    for (size_t i = 0; i < n; i++) e[i].t_us -= base;
+    qsort(e, n, sizeof(*e), db_cmp_edge);
+    *out = e;
+    return (long)n;
+}
+
+// Real transitions: levels that hold for stable_us (or to the end of the
+// trace). Line l owns tr[off[l]..], at most one entry per edge of the line.
+static unsigned long db_truth(const btns_sig_edge_t *e, long n, unsigned lines, uint64_t stable_us,
+                              struct db_trans *tr, const unsigned long *off, unsigned long *ntr)
+{
+    unsigned long total = 0;
+    for (unsigned l = 0; l < lines; l++) {
+        int settled = 1;
+        uint64_t start = 0;
+        bool burst = false;
+        ntr[l] = 0;
+        for (long i = 0; i < n; i++) {
+            if (e[i].line != l) continue;
+            long j = i + 1;
+            while (j < n && e[j].line != l) j++;
+            if (!burst) { start = e[i].t_us; burst = true; }
+            if (j < n && e[j].t_us - e[i].t_us < stable_us) continue;
+            if (e[i].level != settled) {
+                tr[off[l] + ntr[l]++] = (struct db_trans){ start, e[i].level == 0 };
+                settled = e[i].level;
+            }
+            burst = false;
+        }
+        total += ntr[l];
+    }
+    return total;
+}
+
+static int bench_debounce(int argc, char **argv)
+{
+    const char *trace  = opt_str(argc, argv, "--trace", NULL);
+    const char *record = opt_str(argc, argv, "--record", NULL);
+    unsigned debounce  = (unsigned)opt_ul(argc, argv, "--debounce-ms", 10);
+    unsigned stable    = (unsigned)opt_ul(argc, argv, "--stable-ms", 20);
+    const char *model  = opt_str(argc, argv, "--model", "field");
+    unsigned lines = 0;
+    btns_sig_edge_t *e = NULL;
+    long n;
+    if (trace) {
+        n = db_load(trace, &e, &lines);
+    } else {
+        btns_signal_model_t m;
+        lines = (unsigned)opt_ul(argc, argv, "--lines", 4);
+        if (lines == 0 || lines > DB_MAX_LINES) { fprintf(stderr, "--lines 1..%d\n", DB_MAX_LINES); return 2; }
+        if (btns_signal_preset(model, &m)) {
+            fprintf(stderr, "unknown --model %s (%s)\n", model, btns_signal_presets());
+            return 2;
+        }
+        m.seed = opt_ul(argc, argv, "--seed", 0);
+        n = btns_signal_generate(&m, lines, (unsigned)opt_ul(argc, argv, "--seconds", 5) * 1000u, &e);
+    }
+    if (n <= 0) { fprintf(stderr, "empty trace\n"); free(e); return 1; }
+    if (record) {
+        FILE *f = fopen(record, "w");
+        if (!f) { fprintf(stderr, "%s: %s\n", record, strerror(errno)); free(e); return 1; }
+        fprintf(f, "# t_us line level kind\n");
+        for (long i = 0; i < n; i++)
+            fprintf(f, "%llu %u %d %s\n", (unsigned long long)e[i].t_us, e[i].line, e[i].level,
+                    btns_sig_kind_name(e[i].kind));
+        fclose(f);
+    }
+
+    struct db_trans *tr = malloc((size_t)n * sizeof(*tr));
+    unsigned long ntr[DB_MAX_LINES], off[DB_MAX_LINES] = { 0 };
+    for (long i = 0; i < n; i++)
+        for (unsigned l = e[i].line + 1; l < lines; l++) off[l]++;
+    struct db_bench db = { .max = (unsigned long)n + 16 };
+    db.ev = malloc(db.max * sizeof(*db.ev));
+    uint64_t *lat = malloc((size_t)n * sizeof(*lat));
+    if (!tr || !db.ev || !lat) return 1;
+    unsigned long want = db_truth(e, n, lines, (uint64_t)stable * 1000u, tr, off, ntr);
+
+    btn_pin_t pins[DB_MAX_LINES];
+    for (unsigned l = 0; l < lines; l++)
+        pins[l] = (btn_pin_t){ .gpio = DB_GPIO + l, .active_low = true, .enable_pull = true };
+
+    printf("debounce: %s lines=%u edges=%ld transitions=%lu span=%.1fs debounce=%ums stable=%ums\n",
+           trace ? trace : model, lines, n, want, (double)e[n - 1].t_us / 1e6, debounce, stable);
+    printf("%-9s %8s %8s %6s %7s %9s %9s %9s %11s\n", "mode", "events", "matched", "false", "missed",
+           "lat_p50_ms", "lat_p99_ms", "lat_max_ms", "cpu_us/event");
+    gpio_mock_emulate_filter(true);
+    static const btns_debounce_t ROWS[] = { BTNS_DEBOUNCE_SOFTWARE, BTNS_DEBOUNCE_KERNEL, BTNS_DEBOUNCE_BOTH };
+    for (size_t r = 0; r < sizeof(ROWS) / sizeof(ROWS[0]); r++) {
+        db.n = 0;
+        btns_config_t cfg = {
+            .pins = pins, .count = lines, .debounce_ms = debounce, .debounce_mode = ROWS[r],
+            .hold_ms = 1000000, .user = &db, .on_event = db_on_event,
+        };
+        btns_ctx_t *ctx = btns_create(&cfg);
+        if (!ctx) { fprintf(stderr, "btns_create failed\n"); return 1; }
+
+        gpio_mock_time_alerts(true);
+        db.t0 = now_ns();
+        gpio_mock_play(e, (size_t)n, DB_GPIO, db.t0);
+        usleep((useconds_t)(debounce + stable + 50) * 1000u);   // let the last edges settle
+        btns_timer_stats_t ts;
+        uint64_t cpu_ns = gpio_mock_alert_cpu_ns();
+        if (btns_get_timer_stats(ctx, &ts) == 0) cpu_ns += ts.cpu_ns;
+        gpio_mock_time_alerts(false);
+        btns_destroy(ctx);
+        for (unsigned l = 0; l < lines; l++) gpio_mock_set_level(DB_GPIO + l, 1);
+
+        // Events of a line arrive in order: walk them against its transitions
+        unsigned long got = db.n < db.max ? db.n : db.max, matched = 0, fals = 0, missed = 0;
+        for (unsigned l = 0; l < lines; l++) {
+            const struct db_trans *t = &tr[off[l]];
+            unsigned long k = 0;
+            for (unsigned long i = 0; i < got; i++) {
+                const struct db_event *ev = &db.ev[i];
+                if (ev->line != l) continue;
+                while (k + 1 < ntr[l] && ev->t_ns >= t[k + 1].start_us * 1000u) { missed++; k++; }
+                if (k < ntr[l] && ev->press == t[k].press && ev->t_ns >= t[k].start_us * 1000u) {
+                    lat[matched++] = ev->t_ns - t[k].start_us * 1000u;
+                    k++;
+                } else {
+                    fals++;
+                }
+            }
+            missed += ntr[l] - k;
+        }
+        qsort(lat, matched, sizeof(*lat), db_cmp_lat);
+        double cpu = (double)cpu_ns / 1e3;
+        printf("%-9s %8lu %8lu %6lu %7lu %9.2f %9.2f %9.2f %11.1f\n", btns_debounce_name(ROWS[r]), got,
+               matched, fals, missed,
+               matched ? (double)lat[matched / 2] / 1e6 : 0.0,
+               matched ? (double)lat[(matched * 99) / 100] / 1e6 : 0.0,
+               matched ? (double)lat[matched - 1] / 1e6 : 0.0,
+               got ? cpu / (double)got : 0.0);
+    }
+    gpio_mock_emulate_filter(false);
+    free(e); free(tr); free(db.ev); free(lat);
+    return 0;
+}
+
+// ---------- main ----------
+struct bench_mode {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+};
+
+static const struct bench_mode MODES[] = {
+    { "prio", bench_prio,
+      "[--normal N] [--duration-ms N] [--burst N] [--burst-gap-us N] [--cb-us N] [--crit-period-us N]" },
+    { "vdebounce", bench_vdebounce,
+      "[--samples N] [--frames N] [--rounds N]" },
+    { "scan", bench_scan,
+      "[--inputs N] [--changes N] [--frames N] [--rounds N]" },
+    { "threads", bench_threads,
+      "[--presses N] [--hold-ms N]" },
+    { "timers", bench_timers,
+      "[--held N] [--duration-ms N] [--repeat-ms N] [--stagger-ms N]" },
+    { "turbo", bench_turbo,
+      "[--held N] [--duration-ms N] [--period-ms N]" },
+    { "frame", bench_frame,
+      "[--duration-ms N] [--rate N] [--frame-us N] [--holdback-ms N] [--slack-us N]" },
+    { "analog", bench_analog,
+      "[--keys N] [--scans N] [--noise RAW] [--delta T] [--actuation T] [--out FILE]" },
+    { "subs", bench_subs,
+      "[--buttons N] [--subs N] [--presses N]" },
+    { "budget", bench_budget,
+      "[--presses N] [--budget-us N] [--cb-ns N] [--slow-us N] [--slow-every N]" },
+    { "pipeline", bench_pipeline,
+      "[--keys N] [--chord K] [--cycles N | --model NAME --seconds N] [--min-gap-ms N]" },
+    { "shards", bench_shards,
+      "[--chips N] [--lines N] [--max-shards N] [--rounds N]" },
+    { "debounce", bench_debounce,
+      "[--trace FILE | --model NAME --lines N --seconds N --seed N] [--record FILE]"
+      " [--debounce-ms N] [--stable-ms N]" },
+};
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s <mode> [--perf] [options]\n", prog);
+    for (size_t i = 0; i < sizeof(MODES) / sizeof(MODES[0]); i++)
+        fprintf(stderr, "  %s %s\n", MODES[i].name, MODES[i].help);
+    fprintf(stderr, "--perf: cycles/instructions/cache/branch misses per event"
+                    " (vdebounce scan analog pipeline subs budget)\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) { usage(argv[0]); return 2; }
+    for (int i = 2; i < argc; i++)
+        if (!strcmp(argv[i], "--perf")) { perf_open(); break; }
+    for (size_t i = 0; i < sizeof(MODES) / sizeof(MODES[0]); i++)
+        if (!strcmp(argv[1], MODES[i].name)) return MODES[i].run(argc, argv);
+    usage(argv[0]);
+    return 2;
+}
@@ -1,198 +1,499 @@
 // SPDX-License-Identifier: MIT
-// GPIO -> uinput virtual keyboard (libgpiod v2 backend)
+// GPIO -> uinput (or UHID) virtual keyboard (libgpiod v2 backend)
 // ASCII-only comments.
+// The event path (filtering, key mapping, autofire, output devices) is the
+// btns_pipe library; this file wires options, GPIO feedback and diagnostics.
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
-#include <strings.h>
 #include <errno.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <sys/time.h>
-#include <linux/uinput.h>
-#include <linux/input.h>
 
-#include "buttons.h"  // ensure we see buttons_gpio_* and BUTTONS_MAX_LINES
+#include "buttons.h"  // ensure we see buttons_gpio_*, btns_pipe_* and BUTTONS_MAX_LINES
+#include "btns_signal.h"  // --loadgen-model streams (static btns_sim helper)
 
 #ifndef BUTTONS_MAX_LINES
 #define BUTTONS_MAX_LINES 64
 #endif
 
-struct key_map {
-    unsigned offset;   // gpio line offset
-    int keycode;       // linux input key code
+struct fb_map {
+    unsigned in_offset;   // input line offset
+    unsigned out_offset;  // output line (LED/buzzer) driven while pressed
 };
 
-struct state_per_line {
-    uint64_t last_ts_ns;  // last event timestamp (ns)
-    int last_level;       // -1 unknown, 0 released, 1 pressed
-};
+static int parse_feedback(const char *spec, struct fb_map *out, size_t *count_out)
+{
+    if (!spec || !out || !count_out) return -EINVAL;
+    char *tmp = strdup(spec);
+    if (!tmp) return -ENOMEM;
 
-struct app_ctx {
-    int ufd;
-    struct buttons_gpio_ctx *gpio;
-    struct key_map *map;
-    size_t map_count;
-    unsigned min_gap_ms;
-    struct state_per_line st[BUTTONS_MAX_LINES];
-};
+    size_t n = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(tmp, ",", &save);
+         tok && n < BUTTONS_MAX_LINES;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        char *e1 = NULL, *e2 = NULL;
+        long in = strtol(tok, &e1, 0);
+        if (!e1 || *e1 != ':' || in < 0 || in > 1023) { free(tmp); return -EINVAL; }
+        long o = strtol(e1 + 1, &e2, 0);
+        if (!e2 || *e2 != '\0' || o < 0 || o > 1023) { free(tmp); return -EINVAL; }
+
+        out[n].in_offset  = (unsigned)in;
+        out[n].out_offset = (unsigned)o;
+        n++;
+    }
 
-static uint64_t tv_to_ns(const struct timeval *tv)
-{
-    return (uint64_t)tv->tv_sec * 1000000000ull + (uint64_t)tv->tv_usec * 1000ull;
+    free(tmp);
+    *count_out = n;
+    return (n > 0) ? 0 : -EINVAL;
 }
 
-static int uinput_open(void)
+
+// Unique output offsets referenced by the feedback map
+static size_t build_output_offsets(const struct fb_map *fb, size_t n, unsigned *offs_out)
 {
-    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
-    if (fd < 0) return -errno ? -errno : -ENODEV;
-    return fd;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t j = 0;
+        while (j < k && offs_out[j] != fb[i].out_offset) j++;
+        if (j == k) offs_out[k++] = fb[i].out_offset;
+    }
+    return k;
 }
 
-static int uinput_setup_keyboard(int fd, const int *keycodes, size_t n)
+static uint64_t now_ns(void)
 {
-    if (ioctl(fd, UI_SET_EVBIT, EV_KEY) < 0) return -errno;
-    if (ioctl(fd, UI_SET_EVBIT, EV_SYN) < 0) return -errno;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
-    for (size_t i = 0; i < n; i++) {
-        if (keycodes[i] > 0)
-            if (ioctl(fd, UI_SET_KEYBIT, keycodes[i]) < 0) return -errno;
-    }
+// ---------- Keypads ----------
+// Each --keypad section is a separate pipeline (own GPIO request, output
+// device, filter state, metrics and flight recorder); all of them are served
+// from one epoll loop in one thread.
+#define MAX_KEYPADS         8
+#define FLIGHT_RECORDER_LEN 256
+
+// Analog keys (IIO buffer, rapid trigger): map offsets are channel indices of
+// the IIO scan; see btns_source_iio_open.
+struct iio_opts {
+    const char *path;             // NULL = GPIO input
+    unsigned sample_bytes;
+    bool timestamp;
+    btns_analog_key_t key;        // same calibration for every key
+};
 
-    struct uinput_setup us;
-    memset(&us, 0, sizeof(us));
-    us.id.bustype = BUS_USB;
-    us.id.vendor  = 0x0001;
-    us.id.product = 0x0001;
-    us.id.version = 0x0001;
-    snprintf(us.name, sizeof(us.name), "Keypad HID (buttons-sdk)");
+struct keypad_opts {
+    const char *name;
+    const char *chip;
+    bool active_low;
+    unsigned debounce_ms;
+    unsigned min_gap_ms;
+    const char *map_spec;
+    const char *fb_spec;
+    const char *turbo_spec;
+    bool fb_active_low;
+    btns_sink_kind_t out;
+    struct iio_opts iio;
+};
 
-    if (ioctl(fd, UI_DEV_SETUP, &us) < 0) return -errno;
-    if (ioctl(fd, UI_DEV_CREATE) < 0) return -errno;
-    return 0;
-}
+struct edge_rec {
+    uint64_t ts_ns;
+    unsigned offset;
+    uint8_t  level;
+    uint8_t  action;   // btns_pipe_action_t
+};
 
-static int uinput_emit(int fd, uint16_t type, uint16_t code, int32_t value)
-{
-    struct input_event ev;
-    memset(&ev, 0, sizeof(ev));
-    gettimeofday(&ev.time, NULL); // input_event expects timeval
-    ev.type  = type;
-    ev.code  = code;
-    ev.value = value;
-
-    ssize_t w = write(fd, &ev, sizeof(ev));
-    if (w != (ssize_t)sizeof(ev)) return -EIO;
-
-    struct input_event syn;
-    memset(&syn, 0, sizeof(syn));
-    gettimeofday(&syn.time, NULL);
-    syn.type = EV_SYN;
-    syn.code = SYN_REPORT;
-    syn.value = 0;
-    w = write(fd, &syn, sizeof(syn));
-    if (w != (ssize_t)sizeof(syn)) return -EIO;
+struct keypad {
+    struct keypad_opts o;
+    btns_pipe_t *pipe;
+    btns_keymap_t map[BUTTONS_MAX_LINES];   // loadgen: lines to drive
+    size_t map_count;
+    struct buttons_gpio_ctx *gpio;          // NULL for IIO input / loadgen
+    bool null_sink;        // output goes to /dev/null (loadgen / no device)
+    bool done;             // source ended or failed: out of the loop
+    bool trace;            // log every edge to stderr
+    struct edge_rec fr[FLIGHT_RECORDER_LEN];
+    uint64_t fr_head;
+};
 
-    return 0;
-}
+struct app_ctx {
+    struct keypad kp[MAX_KEYPADS];
+    unsigned nkp;
+    int ctl_fd;            // diagnostics socket (-1 = disabled)
+};
 
-static int uinput_send_key(int fd, int keycode, int value01)
+// btns_pipe on_edge hook: every edge, whatever the pipeline did with it
+static void edge_record(void *user, unsigned offset, int level, uint64_t ts_ns, btns_pipe_action_t action)
 {
-    return uinput_emit(fd, EV_KEY, (uint16_t)keycode, value01);
+    struct keypad *kp = user;
+    struct edge_rec *r = &kp->fr[kp->fr_head++ % FLIGHT_RECORDER_LEN];
+    r->ts_ns  = ts_ns;
+    r->offset = offset;
+    r->level  = (uint8_t)level;
+    r->action = (uint8_t)action;
+    if (kp->trace)
+        fprintf(stderr, "trace: %s ts=%llu off=%u level=%d %s\n", kp->o.name,
+                (unsigned long long)ts_ns, offset, level, btns_pipe_action_name(action));
 }
 
-static int keyname_to_code(const char *name)
-{
-    if (strcasecmp(name, "up")    == 0) return KEY_UP;
-    if (strcasecmp(name, "down")  == 0) return KEY_DOWN;
-    if (strcasecmp(name, "left")  == 0) return KEY_LEFT;
-    if (strcasecmp(name, "right") == 0) return KEY_RIGHT;
-    if (strcasecmp(name, "enter") == 0) return KEY_ENTER;
-    if (strcasecmp(name, "esc")   == 0 || strcasecmp(name, "escape") == 0) return KEY_ESC;
-
-    char *end = NULL;
-    long v = strtol(name, &end, 0);
-    if (end && *end == '\0' && v > 0 && v < 1024) return (int)v;
-
-    return -EINVAL;
-}
+// ---------- Diagnostics socket (keypadctl stats|latency|trace|dump [keypad]) ----------
+#define CTL_SOCKET_DEFAULT "/run/keypad-hid.sock"
+
 
-static int parse_map(const char *spec, struct key_map *out, size_t *count_out)
+static int ctl_open(const char *path)
 {
-    if (!spec || !out || !count_out) return -EINVAL;
-    char *tmp = strdup(spec);
-    if (!tmp) return -ENOMEM;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -errno;
+
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa.sun_path)) { close(fd); return -ENAMETOOLONG; }
+    strcpy(sa.sun_path, path);
+
+    // A socket someone still accepts on belongs to a live instance: keep
+    // it. Only a stale one (nobody listening) is replaced.
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        int live = connect(probe, (struct sockaddr *)&sa, sizeof(sa)) == 0;
+        close(probe);
+        if (live) { close(fd); return -EADDRINUSE; }
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 4) < 0) {
+        int e = -errno;
+        close(fd);
+        return e;
+    }
+    chmod(path, 0660);
+    return fd;
+}
 
-    size_t n = 0;
-    char *save = NULL;
-    for (char *tok = strtok_r(tmp, ",", &save);
-         tok && n < BUTTONS_MAX_LINES;
-         tok = strtok_r(NULL, ",", &save))
-    {
-        char *colon = strchr(tok, ':');
-        if (!colon) { free(tmp); return -EINVAL; }
-        *colon = '\0';
-        const char *s_off = tok;
-        const char *s_key = colon + 1;
 
-        char *e1 = NULL;
-        long off = strtol(s_off, &e1, 0);
-        if (!e1 || *e1 != '\0' || off < 0 || off > 1023) { free(tmp); return -EINVAL; }
+static void ctl_print_latency(FILE *f, const btns_hist_t *h)
+{
+    fprintf(f, "count %llu\np50_ns %llu\np90_ns %llu\np99_ns %llu\np99_9_ns %llu\nmax_ns %llu\nmean_ns %.0f\n",
+            (unsigned long long)h->count,
+            (unsigned long long)btns_hist_percentile(h, 50.0),
+            (unsigned long long)btns_hist_percentile(h, 90.0),
+            (unsigned long long)btns_hist_percentile(h, 99.0),
+            (unsigned long long)btns_hist_percentile(h, 99.9),
+            (unsigned long long)h->max_ns,
+            h->count ? (double)h->sum_ns / (double)h->count : 0.0);
+}
 
-        int code = keyname_to_code(s_key);
-        if (code < 0) { free(tmp); return -EINVAL; }
+static void ctl_keypad(FILE *f, struct keypad *kp, const char *verb)
+{
+    if (!strcmp(verb, "stats")) {
+        btns_pipe_stats_t m;
+        btns_pipe_get_stats(kp->pipe, &m);
+        fprintf(f, "edges %llu\nbatches %llu\nkeys_sent %llu\nframes %llu\nsuppressed %llu\n"
+                   "unmapped %llu\nwrite_errors %llu\nturbo %llu\ntrace %s\n",
+                (unsigned long long)m.edges, (unsigned long long)m.batches,
+                (unsigned long long)m.keys_sent, (unsigned long long)m.frames,
+                (unsigned long long)m.suppressed,
+                (unsigned long long)m.unmapped, (unsigned long long)m.write_errors,
+                (unsigned long long)m.turbo, kp->trace ? "on" : "off");
+    } else if (!strcmp(verb, "latency")) {
+        ctl_print_latency(f, btns_pipe_latency(kp->pipe));
+    } else if (!strcmp(verb, "trace on") || !strcmp(verb, "trace off")) {
+        kp->trace = !strcmp(verb, "trace on");
+        fprintf(f, "trace %s\n", kp->trace ? "on" : "off");
+    } else {   // dump
+        uint64_t first = kp->fr_head > FLIGHT_RECORDER_LEN ? kp->fr_head - FLIGHT_RECORDER_LEN : 0;
+        for (uint64_t i = first; i < kp->fr_head; i++) {
+            const struct edge_rec *r = &kp->fr[i % FLIGHT_RECORDER_LEN];
+            fprintf(f, "%llu off=%u level=%u %s\n", (unsigned long long)r->ts_ns,
+                    r->offset, r->level, btns_pipe_action_name((btns_pipe_action_t)r->action));
+        }
+    }
+}
 
-        out[n].offset  = (unsigned)off;
-        out[n].keycode = code;
-        n++;
+// One request per connection: read a command line, answer, close.
+// "<command> [keypad]": without a name every keypad answers, each block
+// headed by "keypad <name>" when more than one is configured.
+static void ctl_serve(struct app_ctx *app)
+{
+    int cfd = accept(app->ctl_fd, NULL, NULL);
+    if (cfd < 0) return;
+    fcntl(cfd, F_SETFD, FD_CLOEXEC);
+
+    struct timeval tv = { 0, 200000 }; // never let a slow client stall the event loop
+    setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char cmd[64];
+    ssize_t n = read(cfd, cmd, sizeof(cmd) - 1);
+    FILE *f = fdopen(cfd, "w");
+    if (!f) { close(cfd); return; }
+    if (n <= 0) { fclose(f); return; }
+    cmd[n] = '\0';
+    cmd[strcspn(cmd, "\r\n")] = '\0';
+
+    static const char *const VERBS[] = { "stats", "latency", "trace on", "trace off", "dump" };
+    const char *verb = NULL, *name = NULL;
+    for (size_t v = 0; v < sizeof(VERBS) / sizeof(VERBS[0]) && !verb; v++) {
+        size_t len = strlen(VERBS[v]);
+        if (strncmp(cmd, VERBS[v], len) || (cmd[len] != '\0' && cmd[len] != ' ')) continue;
+        verb = VERBS[v];
+        name = cmd[len] ? cmd + len + 1 : NULL;
+    }
+    if (!verb) {
+        fprintf(f, "error unknown command: %s\n", cmd);
+        fclose(f);
+        return;
     }
 
-    free(tmp);
-    *count_out = n;
-    return (n > 0) ? 0 : -EINVAL;
+    bool found = false;
+    for (unsigned k = 0; k < app->nkp; k++) {
+        struct keypad *kp = &app->kp[k];
+        if (name && strcmp(name, kp->o.name)) continue;
+        found = true;
+        if (app->nkp > 1) fprintf(f, "keypad %s\n", kp->o.name);
+        ctl_keypad(f, kp, verb);
+    }
+    if (!found) fprintf(f, "error unknown keypad: %s\n", name);
+    fclose(f);
 }
 
-static int build_offsets_array(const struct key_map *m, size_t n, unsigned *offs_out)
+// ---------- Footprint ----------
+#define PREFAULT_STACK_BYTES (64 * 1024)
+
+// Fault in the stack depth used by the event path and pin the app context
+// (the pipelines lock their own state, see btns_pipe_config_t.lock_memory),
+// so a burst after a long idle period does not take page faults.
+static void lock_hot_pages(struct app_ctx *app)
 {
-    for (size_t i = 0; i < n; i++) offs_out[i] = m[i].offset;
-    return 0;
+    // One volatile store per page: memset on a dead local may be dropped
+    volatile char buf[PREFAULT_STACK_BYTES];
+    long pg = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < sizeof(buf); i += (size_t)(pg > 0 ? pg : 4096)) buf[i] = 0;
+    if (mlock(app, sizeof(*app)) != 0)
+        fprintf(stderr, "mlock failed: %s (RLIMIT_MEMLOCK?)\n", strerror(errno));
 }
 
-static int on_gpio_event(unsigned offset, bool rising, uint64_t ts_ns, void *user)
+static long current_rss_kb(void)
 {
-    struct app_ctx *app = (struct app_ctx *)user;
-    int level = rising ? 1 : 0;
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return -1;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = -1;
+    fclose(f);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
 
-    size_t idx = SIZE_MAX;
-    for (size_t i = 0; i < app->map_count; i++)
-        if (app->map[i].offset == offset) { idx = i; break; }
-    if (idx == SIZE_MAX) return 0;
+// ---------- Synthetic load generator ----------
+// Pushes press/release storms through a keypad's pipeline (mapping + sink
+// writes) without touching the GPIO chip. Keypads are driven one after
+// another. With a signal model, each cycle is one pass over a generated raw
+// edge stream (bounce, EMI, ...) instead, pushed as fast as possible with
+// the stream's timestamps: what the filter stage lets through.
+struct loadgen_opts {
+    unsigned long cycles;  // press+release cycles / model passes (0 = disabled)
+    unsigned rate_hz;      // cycles per second, 0 = as fast as possible
+    unsigned chord;        // lines pressed together per cycle
+    unsigned hold_ms;      // synthetic press duration (event timestamps)
+    bool null_sink;        // write to /dev/null instead of the uinput/uhid device
+    const char *model;     // btns_signal preset, NULL = clean chords
+    unsigned model_ms;     // stream length per pass
+};
 
-    struct state_per_line *st = &app->st[idx];
-    uint64_t gap_ns = (uint64_t)app->min_gap_ms * 1000000ull;
+// One batch per stream timestamp; per-edge cost as in the chord storm
+static int loadgen_stream(struct keypad *kp, const struct loadgen_opts *lg, btns_hist_t *h)
+{
+    btns_signal_model_t m;
+    if (btns_signal_preset(lg->model, &m)) {
+        fprintf(stderr, "loadgen: unknown model %s (%s)\n", lg->model, btns_signal_presets());
+        return -EINVAL;
+    }
+    btns_sig_edge_t *e;
+    long n = btns_signal_generate(&m, (unsigned)kp->map_count, lg->model_ms ? lg->model_ms : 60000, &e);
+    if (n < 0) return (int)n;
+
+    int rc = 0;
+    for (unsigned long c = 0; c < lg->cycles && !rc; c++) {
+        uint64_t base = now_ns();
+        for (long i = 0; i < n && !rc;) {
+            uint64_t a = now_ns();
+            long j = i;
+            for (; j < n && e[j].t_us == e[i].t_us && !rc; j++)
+                rc = btns_pipe_edge(kp->pipe, kp->map[e[j].line].offset, e[j].level == 0,
+                                    base + e[j].t_us * 1000u);
+            if (!rc) rc = btns_pipe_flush(kp->pipe);
+            uint64_t per = (now_ns() - a) / (uint64_t)(j - i);
+            for (long k = i; k < j; k++) btns_hist_add(h, per);
+            i = j;
+        }
+    }
+    free(e);
+    return rc;
+}
 
-    if (st->last_level == level) {
-        if (st->last_ts_ns != 0 && ts_ns - st->last_ts_ns < gap_ns)
-            return 0; // suppress same-kind spam within min-gap
+static int loadgen_run(struct keypad *kp, const struct loadgen_opts *lg, const char *sink_name)
+{
+    btns_hist_t *h = calloc(1, sizeof(*h));
+    if (!h) return -ENOMEM;
+
+    unsigned chord = lg->chord ? lg->chord : 1;
+    if (chord > kp->map_count) chord = (unsigned)kp->map_count;
+    uint64_t period_ns = lg->rate_hz ? 1000000000ull / lg->rate_hz : 0;
+    uint64_t hold_ns = (uint64_t)lg->hold_ms * 1000000ull;
+
+    struct rusage ru0, ru1;
+    getrusage(RUSAGE_SELF, &ru0);
+
+    int rc = 0;
+    size_t base = 0;
+    uint64_t t0 = now_ns();
+    if (lg->model) rc = loadgen_stream(kp, lg, h);
+    for (unsigned long c = 0; c < lg->cycles && !lg->model && !rc; c++) {
+        if (period_ns) {
+            uint64_t due = t0 + c * period_ns;
+            struct timespec ts = { (time_t)(due / 1000000000ull), (long)(due % 1000000000ull) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+        uint64_t press_ts = now_ns();
+        for (int phase = 0; phase < 2 && !rc; phase++) {
+            // A chord phase is one poll batch: one sink frame. Its cost is
+            // split evenly over the events.
+            uint64_t ts = press_ts + (phase ? hold_ns : 0);
+            uint64_t a = now_ns();
+            unsigned k;
+            for (k = 0; k < chord && !rc; k++) {
+                unsigned off = kp->map[(base + k) % kp->map_count].offset;
+                rc = btns_pipe_edge(kp->pipe, off, phase == 0, ts);
+            }
+            if (!rc) rc = btns_pipe_flush(kp->pipe);
+            uint64_t per = (now_ns() - a) / (k ? k : 1);
+            for (unsigned j = 0; j < k; j++) btns_hist_add(h, per);
+        }
+        base = (base + chord) % kp->map_count;
     }
+    double secs = (double)(now_ns() - t0) / 1e9;
+    getrusage(RUSAGE_SELF, &ru1);
+    double minflt = (double)(ru1.ru_minflt - ru0.ru_minflt);
+    double majflt = (double)(ru1.ru_majflt - ru0.ru_majflt);
+
+    btns_pipe_stats_t m;
+    btns_pipe_get_stats(kp->pipe, &m);
+    if (rc) fprintf(stderr, "loadgen: %s: sink error: %s\n", kp->o.name, strerror(-rc));
+    fprintf(stdout,
+            "loadgen: keypad=%s sink=%s events=%llu frames=%llu elapsed=%.3fs throughput=%.0f ev/s\n"
+            "loadgen: write latency ns p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu mean=%.0f\n",
+            kp->o.name, sink_name, (unsigned long long)h->count, (unsigned long long)m.frames, secs,
+            secs > 0 ? (double)h->count / secs : 0.0,
+            (unsigned long long)btns_hist_percentile(h, 50.0),
+            (unsigned long long)btns_hist_percentile(h, 90.0),
+            (unsigned long long)btns_hist_percentile(h, 99.0),
+            (unsigned long long)btns_hist_percentile(h, 99.9),
+            (unsigned long long)h->max_ns,
+            h->count ? (double)h->sum_ns / (double)h->count : 0.0);
+    fprintf(stdout,
+            "loadgen: rss_kb=%ld maxrss_kb=%ld minflt=%.0f (%.1f/s) majflt=%.0f (%.1f/s)\n",
+            current_rss_kb(), ru1.ru_maxrss,
+            minflt, secs > 0 ? minflt / secs : 0.0,
+            majflt, secs > 0 ? majflt / secs : 0.0);
+    free(h);
+    return rc;
+}
 
-    int keycode = app->map[idx].keycode;
-    if (keycode < 0) return 0;
+// ---------- Event loop ----------
+// One epoll set for every keypad's pipeline fds (source, uhid requests,
+// autofire timer) + the diagnostics socket. epoll data = keypad << 8 | which.
+// Regular files cannot be added to epoll (IIO stand-in files): those are
+// always readable and go on a ready list polled with a zero timeout.
+#define EP_TAG_CTL    UINT64_MAX
+#define EP_MAX_EVENTS 16
+
+// End of a keypad: summary for finite sources, then out of the loop. The
+// other keypads keep running.
+static void keypad_stop(struct keypad *kp, int epfd, int rc)
+{
+    for (unsigned w = 0; w < BTNS_PIPE_NFDS; w++) {
+        int fd = btns_pipe_fd(kp->pipe, w);
+        if (fd >= 0) epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    kp->done = true;
+    if (rc) fprintf(stderr, "%s: %s\n", kp->o.name, strerror(-rc));
+    if (kp->o.iio.path) {
+        btns_pipe_stats_t m;
+        btns_pipe_get_stats(kp->pipe, &m);
+        fprintf(stdout, "iio: keypad=%s edges=%llu keys_sent=%llu frames=%llu\n", kp->o.name,
+                (unsigned long long)m.edges, (unsigned long long)m.keys_sent,
+                (unsigned long long)m.frames);
+        ctl_print_latency(stdout, btns_pipe_latency(kp->pipe));
+    }
+}
 
-    if (st->last_level != level) {
-        int rc = uinput_send_key(app->ufd, keycode, level ? 1 : 0);
-        if (rc) return rc;
-        st->last_level = level;
-        st->last_ts_ns = ts_ns;
-    } else {
-        st->last_ts_ns = ts_ns;
+// Returns once every keypad has stopped: 0 if all sources ended (IIO stand-in
+// files), else the first error.
+static int run_loop(struct app_ctx *app)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) return -errno;
+
+    uint64_t ready[MAX_KEYPADS * BTNS_PIPE_NFDS];
+    unsigned nready = 0;
+    for (unsigned k = 0; k < app->nkp; k++) {
+        for (unsigned w = 0; w < BTNS_PIPE_NFDS; w++) {
+            int fd = btns_pipe_fd(app->kp[k].pipe, w);
+            if (fd < 0) continue;
+            struct epoll_event ev = { .events = EPOLLIN, .data.u64 = (uint64_t)k << 8 | w };
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0) continue;
+            if (errno != EPERM) { int e = -errno; close(epfd); return e; }
+            ready[nready++] = ev.data.u64;
+        }
+    }
+    if (app->ctl_fd >= 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u64 = EP_TAG_CTL };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, app->ctl_fd, &ev);
     }
 
-    return 0;
+    int rc = 0;
+    unsigned active = app->nkp;
+    struct epoll_event evs[EP_MAX_EVENTS + MAX_KEYPADS * BTNS_PIPE_NFDS];
+    while (active) {
+        int n = epoll_wait(epfd, evs, EP_MAX_EVENTS, nready ? 0 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            rc = -errno;
+            break;
+        }
+        for (unsigned i = 0; i < nready; i++) evs[n++].data.u64 = ready[i];
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = evs[i].data.u64;
+            if (tag == EP_TAG_CTL) { ctl_serve(app); continue; }
+            struct keypad *kp = &app->kp[tag >> 8];
+            if (kp->done) continue;
+            int r = btns_pipe_handle(kp->pipe, (unsigned)(tag & 0xff));
+            if (r >= 0) continue;
+            keypad_stop(kp, epfd, r == -ENODATA ? 0 : r);   // -ENODATA: stand-in file / writer gone
+            if (r != -ENODATA && !rc) rc = r;
+            active--;
+        }
+        // Drop stopped keypads from the ready list
+        unsigned j = 0;
+        for (unsigned i = 0; i < nready; i++)
+            if (!app->kp[ready[i] >> 8].done) ready[j++] = ready[i];
+        nready = j;
+    }
+    close(epfd);
+    return rc;
 }
 
 static void usage(const char *prog)
@@ -200,74 +501,255 @@ static void usage(const char *prog)
     fprintf(stderr,
         "Usage: %s [--chip <name_or_path>] [--active-low] [--debounce-ms N]\n"
         "          [--min-gap-ms N] --map \"off:key,...\"\n"
+        "          [--feedback \"in_off:out_off,...\"] [--feedback-active-low]\n"
+        "          [--output uinput|uhid]   uhid: HID keyboard, one NKRO report per batch\n"
+        "          [--turbo \"off:period_ms,...\"]   autofire while held (mapped lines)\n"
+        "          [--keypad NAME ...]   start another keypad section (up to %d);\n"
+        "          the options above apply to the current section\n"
         "Example: %s --chip gpiochip0 --active-low --debounce-ms 35 \n"
-        "          --min-gap-ms 150 --map \"17:up,22:down,23:left,24:right,25:enter,27:esc\"\n",
-        prog, prog);
+        "          --min-gap-ms 150 --map \"17:up,22:down,23:left,24:right,25:enter,27:esc\"\n"
+        "          --feedback \"17:5,22:6\"   (LED on line 5 lit while 17 is pressed)\n"
+        "          --keypad service --chip gpiochip1 --map \"3:enter,4:esc\"\n"
+        "          [--lock-memory]   prefault stack and mlock the event-path state\n"
+        "          [--ctl-socket PATH|none]   diagnostics socket (default " CTL_SOCKET_DEFAULT ")\n"
+        "Load generator (no GPIO access):\n"
+        "          --loadgen CYCLES [--loadgen-rate HZ] [--loadgen-chord K]\n"
+        "          [--loadgen-hold-ms MS] [--loadgen-sink device|null]\n"
+        "          [--loadgen-model NAME [--loadgen-model-ms MS]]   CYCLES passes over a\n"
+        "          raw edge stream with bounce/EMI/shorts (clean new worn cable emi field harsh)\n"
+        "Analog keys (IIO buffer or stand-in file, map offsets = channels, per section):\n"
+        "          --iio PATH [--iio-bytes 1|2|4] [--iio-timestamp]\n"
+        "          [--rt-rest RAW] [--rt-bottom RAW] [--rt-deadzone T] [--rt-press T] [--rt-release T]\n"
+        "          travel T in 0..1000 of rest..bottom (rapid trigger)\n",
+        prog, MAX_KEYPADS, prog);
 }
 
-int main(int argc, char **argv)
+static void ctl_start(struct app_ctx *app, const char *path)
 {
-    const char *chip = "gpiochip0";
-    bool active_low = false;
-    unsigned debounce_ms = 35;
-    unsigned min_gap_ms = 150;
-    const char *map_spec = NULL;
+    if (!strcmp(path, "none")) return;
+    app->ctl_fd = ctl_open(path);
+    if (app->ctl_fd < 0)
+        fprintf(stderr, "diagnostics socket %s disabled: %s\n", path, strerror(-app->ctl_fd));
+}
 
-    for (int i = 1; i < argc; i++) {
-        if (!strcmp(argv[i], "--chip") && i + 1 < argc) { chip = argv[++i]; continue; }
-        if (!strcmp(argv[i], "--active-low")) { active_low = true; continue; }
-        if (!strcmp(argv[i], "--debounce-ms") && i + 1 < argc) { debounce_ms = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
-        if (!strcmp(argv[i], "--min-gap-ms") && i + 1 < argc) { min_gap_ms = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
-        if (!strcmp(argv[i], "--map") && i + 1 < argc) { map_spec = argv[++i]; continue; }
-        if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) { usage(argv[0]); return 0; }
-        fprintf(stderr, "Unknown option: %s\n", argv[i]); usage(argv[0]); return 2;
-    }
+// Parse, open and wire one keypad section. 0, or the process exit code.
+static int keypad_open(struct keypad *kp, const struct loadgen_opts *lg, bool lock_memory)
+{
+    const struct keypad_opts *o = &kp->o;
+    if (!o->map_spec) { fprintf(stderr, "%s: --map is required.\n", o->name); return 2; }
 
-    if (!map_spec) { fprintf(stderr, "--map is required.\n"); usage(argv[0]); return 2; }
+    if (btns_keymap_parse(o->map_spec, kp->map, BUTTONS_MAX_LINES, &kp->map_count) != 0) {
+        fprintf(stderr, "%s: invalid --map.\n", o->name); return 2;
+    }
 
-    struct key_map map[BUTTONS_MAX_LINES];
-    size_t map_count = 0;
-    if (parse_map(map_spec, map, &map_count) != 0) {
-        fprintf(stderr, "Invalid --map.\n"); return 2;
+    if (o->turbo_spec && btns_keymap_parse_turbo(o->turbo_spec, kp->map, kp->map_count) != 0) {
+        fprintf(stderr, "%s: invalid --turbo (off:period_ms, off must be in --map, period >= 2).\n",
+                o->name);
+        return 2;
     }
 
     unsigned offsets[BUTTONS_MAX_LINES];
-    build_offsets_array(map, map_count, offsets);
+    for (size_t i = 0; i < kp->map_count; i++) offsets[i] = kp->map[i].offset;
+
+    struct fb_map fb[BUTTONS_MAX_LINES];
+    size_t fb_count = 0;
+    unsigned out_offsets[BUTTONS_MAX_LINES];
+    size_t out_count = 0;
+    if (o->fb_spec) {
+        if (parse_feedback(o->fb_spec, fb, &fb_count) != 0) {
+            fprintf(stderr, "%s: invalid --feedback.\n", o->name); return 2;
+        }
+        out_count = build_output_offsets(fb, fb_count, out_offsets);
+    }
 
-    int ufd = uinput_open();
-    if (ufd < 0) { fprintf(stderr, "uinput open failed: %s\n", strerror(-ufd)); return 1; }
+    const char *out_name = o->out == BTNS_SINK_UHID ? "uhid" : "uinput";
+    if (o->out == BTNS_SINK_UHID) {
+        for (size_t i = 0; i < kp->map_count; i++) {
+            if (kp->map[i].keycode > 0 && btns_key_to_hid_usage(kp->map[i].keycode) < 0) {
+                fprintf(stderr, "%s: key %d on line %u has no HID usage.\n", o->name,
+                        kp->map[i].keycode, kp->map[i].offset);
+                return 2;
+            }
+        }
+    }
 
-    int keycodes[BUTTONS_MAX_LINES];
-    for (size_t i = 0; i < map_count; i++) keycodes[i] = map[i].keycode;
-    if (uinput_setup_keyboard(ufd, keycodes, map_count) != 0) {
-        fprintf(stderr, "uinput setup failed.\n");
-        close(ufd); return 1;
+    unsigned channels = 0;
+    if (o->iio.path) {
+        for (size_t i = 0; i < kp->map_count; i++)
+            if (kp->map[i].offset + 1 > channels) channels = kp->map[i].offset + 1;
+        if (channels > BUTTONS_MAX_LINES) {
+            fprintf(stderr, "%s: iio channel index must be < %d\n", o->name, BUTTONS_MAX_LINES);
+            return 2;
+        }
     }
 
-    struct app_ctx app;
-    memset(&app, 0, sizeof(app));
-    app.ufd = ufd;
-    app.map = map;
-    app.map_count = map_count;
-    app.min_gap_ms = min_gap_ms;
-    for (size_t i = 0; i < BUTTONS_MAX_LINES; i++) {
-        app.st[i].last_level = -1;
-        app.st[i].last_ts_ns = 0;
+    btns_sink_t *sink = NULL;
+    kp->null_sink = lg->null_sink;
+    int rc = lg->null_sink ? -ENODEV : btns_sink_open(&sink, o->out, kp->map, kp->map_count);
+    if (rc < 0 && (lg->cycles || o->iio.path)) {
+        // Fake sink: same write() path, no virtual device
+        if (!lg->null_sink) fprintf(stderr, "%s: %s unavailable, using /dev/null sink\n", o->name, out_name);
+        rc = btns_sink_null_open(&sink, o->out);
+        kp->null_sink = true;
+    }
+    if (rc < 0) { fprintf(stderr, "%s: %s setup failed: %s\n", o->name, out_name, strerror(-rc)); return 1; }
+
+    btns_source_t *src = NULL;
+    if (o->iio.path && !lg->cycles) {
+        rc = btns_source_iio_open(&src, o->iio.path, channels, o->iio.sample_bytes, o->iio.timestamp, &o->iio.key);
+        if (rc < 0) {
+            fprintf(stderr, "%s: iio open %s failed: %s\n", o->name, o->iio.path, strerror(-rc));
+            sink->destroy(sink); return 1;
+        }
+    } else if (!lg->cycles) {
+        if (buttons_gpio_open_ex(&kp->gpio, o->chip, offsets, kp->map_count, o->active_low,
+                                 o->debounce_ms, 64, out_offsets, out_count, o->fb_active_low) != 0) {
+            fprintf(stderr, "%s: gpio open failed.\n", o->name);
+            sink->destroy(sink); return 1;
+        }
+        for (size_t i = 0; i < fb_count; i++) {
+            if (buttons_gpio_set_feedback(kp->gpio, fb[i].in_offset, fb[i].out_offset) != 0)
+                fprintf(stderr, "%s: feedback %u:%u ignored (input not in --map)\n",
+                        o->name, fb[i].in_offset, fb[i].out_offset);
+        }
+        rc = btns_source_gpio_open(&src, kp->gpio);
+        if (rc < 0) {
+            buttons_gpio_close(kp->gpio);
+            kp->gpio = NULL;
+            sink->destroy(sink); return 1;
+        }
     }
 
-    if (buttons_gpio_open(&app.gpio, chip, offsets, map_count, active_low, debounce_ms, 64) != 0) {
-        fprintf(stderr, "gpio open failed.\n");
-        ioctl(ufd, UI_DEV_DESTROY);
-        close(ufd); return 1;
+    btns_pipe_config_t pc;
+    memset(&pc, 0, sizeof(pc));
+    pc.map = kp->map;
+    pc.map_count = kp->map_count;
+    pc.min_gap_ms = o->min_gap_ms;
+    pc.source = src;
+    pc.sink = sink;
+    pc.on_edge = edge_record;
+    pc.user = kp;
+    pc.lock_memory = lock_memory;
+    kp->pipe = btns_pipe_create(&pc);
+    if (!kp->pipe) {
+        fprintf(stderr, "%s: pipeline setup failed: %s\n", o->name, strerror(errno));
+        if (src) src->destroy(src);
+        sink->destroy(sink);
+        return 1;
     }
+    return 0;
+}
+
+static void keypad_close(struct keypad *kp)
+{
+    btns_pipe_destroy(kp->pipe);   // source and sink
+    if (kp->gpio) buttons_gpio_close(kp->gpio);
+    kp->pipe = NULL;
+    kp->gpio = NULL;
+}
 
-    for (;;) {
-        int r = buttons_gpio_poll(app.gpio, 1000, on_gpio_event, &app);
-        if (r < 0) { fprintf(stderr, "poll error: %d\n", r); break; }
+static const struct keypad_opts KEYPAD_DEFAULTS = {
+    .name = "default", .chip = "gpiochip0", .debounce_ms = 35, .min_gap_ms = 150,
+    .out = BTNS_SINK_UINPUT, .iio = { NULL, 2, false, { 0, 4095, 100, 50, 50 } },
+};
+
+static struct app_ctx app;   // large (flight recorders): not on the stack
+
+int main(int argc, char **argv)
+{
+    struct loadgen_opts lg = { 0, 0, 1, 0, false, NULL, 0 };
+    const char *ctl_path = CTL_SOCKET_DEFAULT;
+    bool lock_memory = false;
+
+    app.ctl_fd = -1;
+    app.nkp = 1;
+    app.kp[0].o = KEYPAD_DEFAULTS;
+    bool section_used = false;   // options given since the last --keypad
+    for (int i = 1; i < argc; i++) {
+        struct keypad_opts *o = &app.kp[app.nkp - 1].o;
+        if (!strcmp(argv[i], "--keypad") && i + 1 < argc) {
+            if (section_used) {
+                if (app.nkp == MAX_KEYPADS) { fprintf(stderr, "At most %d keypads.\n", MAX_KEYPADS); return 2; }
+                o = &app.kp[app.nkp++].o;
+                *o = KEYPAD_DEFAULTS;
+            }
+            o->name = argv[++i];
+            section_used = false;
+            continue;
+        }
+        // Global options
+        if (!strcmp(argv[i], "--lock-memory")) { lock_memory = true; continue; }
+        if (!strcmp(argv[i], "--ctl-socket") && i + 1 < argc) { ctl_path = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--loadgen") && i + 1 < argc) { lg.cycles = strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--loadgen-rate") && i + 1 < argc) { lg.rate_hz = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--loadgen-chord") && i + 1 < argc) { lg.chord = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--loadgen-hold-ms") && i + 1 < argc) { lg.hold_ms = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--loadgen-sink") && i + 1 < argc) { lg.null_sink = !strcmp(argv[++i], "null"); continue; }
+        if (!strcmp(argv[i], "--loadgen-model") && i + 1 < argc) { lg.model = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--loadgen-model-ms") && i + 1 < argc) { lg.model_ms = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) { usage(argv[0]); return 0; }
+        // Keypad section options
+        section_used = true;
+        if (!strcmp(argv[i], "--chip") && i + 1 < argc) { o->chip = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--active-low")) { o->active_low = true; continue; }
+        if (!strcmp(argv[i], "--debounce-ms") && i + 1 < argc) { o->debounce_ms = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--min-gap-ms") && i + 1 < argc) { o->min_gap_ms = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--map") && i + 1 < argc) { o->map_spec = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--feedback") && i + 1 < argc) { o->fb_spec = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--turbo") && i + 1 < argc) { o->turbo_spec = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--feedback-active-low")) { o->fb_active_low = true; continue; }
+        if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (!strcmp(v, "uhid")) o->out = BTNS_SINK_UHID;
+            else if (strcmp(v, "uinput")) { fprintf(stderr, "Invalid --output: %s\n", v); return 2; }
+            continue;
+        }
+        if (!strcmp(argv[i], "--iio") && i + 1 < argc) { o->iio.path = argv[++i]; continue; }
+        if (!strcmp(argv[i], "--iio-bytes") && i + 1 < argc) { o->iio.sample_bytes = (unsigned)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--iio-timestamp")) { o->iio.timestamp = true; continue; }
+        if (!strcmp(argv[i], "--rt-rest") && i + 1 < argc) { o->iio.key.raw_rest = (int32_t)strtol(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--rt-bottom") && i + 1 < argc) { o->iio.key.raw_bottom = (int32_t)strtol(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--rt-deadzone") && i + 1 < argc) { o->iio.key.deadzone = (uint16_t)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--rt-press") && i + 1 < argc) { o->iio.key.press_delta = (uint16_t)strtoul(argv[++i], NULL, 10); continue; }
+        if (!strcmp(argv[i], "--rt-release") && i + 1 < argc) { o->iio.key.release_delta = (uint16_t)strtoul(argv[++i], NULL, 10); continue; }
+        fprintf(stderr, "Unknown option: %s\n", argv[i]); usage(argv[0]); return 2;
     }
 
-    buttons_gpio_close(app.gpio);
-    ioctl(ufd, UI_DEV_DESTROY);
-    close(ufd);
-    return 0;
+    for (unsigned k = 0; k < app.nkp; k++)
+        for (unsigned j = 0; j < k; j++)
+            if (!strcmp(app.kp[k].o.name, app.kp[j].o.name)) {
+                fprintf(stderr, "Duplicate keypad name: %s\n", app.kp[k].o.name);
+                return 2;
+            }
+
+    int rc = 0;
+    for (unsigned k = 0; k < app.nkp && !rc; k++) {
+        rc = keypad_open(&app.kp[k], &lg, lock_memory);
+        if (rc) {
+            if (!app.kp[k].o.map_spec) usage(argv[0]);
+            while (k--) keypad_close(&app.kp[k]);
+            return rc;
+        }
+    }
+
+    if (lock_memory) lock_hot_pages(&app);
+
+    if (lg.cycles) {
+        for (unsigned k = 0; k < app.nkp && !rc; k++) {
+            const char *out_name = app.kp[k].o.out == BTNS_SINK_UHID ? "uhid" : "uinput";
+            char sink_name[16];
+            snprintf(sink_name, sizeof(sink_name), "%s%s", out_name, app.kp[k].null_sink ? "/null" : "");
+            rc = loadgen_run(&app.kp[k], &lg, sink_name);
+        }
+        for (unsigned k = 0; k < app.nkp; k++) keypad_close(&app.kp[k]);
+        return rc ? 1 : 0;
+    }
+
+    ctl_start(&app, ctl_path);
+    rc = run_loop(&app);
+    if (rc) fprintf(stderr, "event loop: %s\n", strerror(-rc));
+
+    if (app.ctl_fd >= 0) { close(app.ctl_fd); unlink(ctl_path); }
+    for (unsigned k = 0; k < app.nkp; k++) keypad_close(&app.kp[k]);
+    return rc ? 1 : 0;
 }
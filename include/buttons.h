@@ -21,13 +21,60 @@ typedef enum {
     BTN_EVENT_RELEASE = 2,  // fiziksel býrakma
     BTN_EVENT_CLICK   = 3,  // kýsa basýþ (hold altý)
     BTN_EVENT_HOLD    = 4,  // uzun basma eþiði aþýldý
-    BTN_EVENT_REPEAT  = 5   // hold sonrasý tekrar
+    BTN_EVENT_REPEAT  = 5,  // hold sonrasý tekrar
+    BTN_EVENT_FAULT   = 6,  // cift kanal uyusmazligi (pair_window_ms asildi)
+    BTN_EVENT_NOISE   = 7,  // kenar patlamasi (noise filter), burst basina bir kez
+    BTN_EVENT_IDLE    = 8,  // idle_ms[index] boyunca girdi yok (gpio = BTNS_NO_GPIO)
+    BTN_EVENT_ACTIVITY = 9, // IDLE sonrasi ilk girdi; index/gpio = o buton, kendi olayindan once
+    BTN_EVENT_OVERRUN  = 10 // callback cb_budget_us'u asti; index = callback id, gpio = BTNS_NO_GPIO
 } btn_event_t;
 
+#define BTNS_NO_GPIO 0xFFFFFFFFu  // on_event gpio for events not tied to a line
+#define BTNS_CB_ON_EVENT 0xFFFFFFFFu  // callback id of cfg.on_event (subscriptions: btns_subscribe id)
+
+typedef enum {
+    BTN_PRIO_NORMAL   = 0,
+    BTN_PRIO_CRITICAL = 1   // ayri kuyruk; her zaman once dagitilir (E-stop, power)
+} btn_prio_t;
+#define BTN_PRIO_COUNT 2
+
+// Where contact bounce is filtered. KERNEL: the backend glitch filter /
+// debounce period only (edges arrive late by debounce_ms, no software
+// check). SOFTWARE: no glitch filter; edges closer than debounce_ms to the
+// last accepted one are dropped (first edge wins, no added latency). BOTH
+// (default): glitch filter and software check.
+typedef enum {
+    BTNS_DEBOUNCE_BOTH = 0,
+    BTNS_DEBOUNCE_KERNEL,
+    BTNS_DEBOUNCE_SOFTWARE
+} btns_debounce_t;
+
 typedef struct {
     unsigned gpio;        // BCM GPIO
     bool     active_low;  // genelde true (pull-up)
     bool     enable_pull; // dahili pull-up/down kullan
+    bool     wakeup;      // suspend'den uyandirir; resume aninda basiliysa PRESS uretir
+    uint8_t  priority;    // btn_prio_t
+
+    // Redundant dual-channel input: event fires only when both contacts agree
+    // within btns_config_t.pair_window_ms, otherwise BTN_EVENT_FAULT.
+    bool     paired;
+    unsigned pair_gpio;     // second contact
+    bool     pair_inverted; // second contact is NC (logical level inverted)
+
+    // Long-cable noise filter: PRESS/RELEASE are decided only after the line is
+    // quiet and confirmed by a level read; edge bursts report BTN_EVENT_NOISE.
+    bool     noise_filter;
+
+    // Autofire: while held, RELEASE/PRESS pairs every turbo_ms (down for
+    // turbo_ms/2, up for the rest; phase-locked to the press) from the engine
+    // timer; replaces HOLD/REPEAT/CLICK for this pin. 0 = off.
+    unsigned turbo_ms;
+
+    // Line group (expander chip) for btns_config_t.shards: a group is never
+    // split across shards (shard = group % shards). All 0 = contiguous blocks
+    // of pin indices.
+    unsigned group;
 } btn_pin_t;
 
 typedef struct {
@@ -35,18 +82,400 @@ typedef struct {
     unsigned count;
 
     unsigned debounce_ms; // 8–20 ms önerilir
+    btns_debounce_t debounce_mode; // see btns_debounce_t; btns_set_debounce() at runtime
     unsigned hold_ms;     // uzun basma eþiði
     unsigned repeat_ms;   // HOLD sonrasý tekrar aralýðý (0=kapalý)
+    unsigned pair_window_ms; // cift kanal uyum penceresi (0 = 20 ms)
+    unsigned noise_edges;     // noise_window_ms icinde bu kadar kenar = NOISE (0 = 4)
+    unsigned noise_window_ms; // (0 = 50 ms)
+    unsigned timer_slack_ms;  // HOLD/REPEAT deadlines this close share one wakeup (0 = exact)
+
+    // Inactivity thresholds in ms, ascending: IDLE(n) after idle_ms[n] without
+    // button events (a held button counts as activity). Copied at create.
+    const unsigned *idle_ms;
+    unsigned        idle_count;
+
+    // Frame-aligned delivery: normal-priority events are buffered and handed
+    // to on_event in one batch when frame_fd becomes readable (vsync eventfd,
+    // timerfd; the engine reads it). An event older than frame_holdback_ms is
+    // delivered without waiting (0 = wait for the frame). Critical pins bypass.
+    bool     frame_sync;
+    int      frame_fd;
+    unsigned frame_holdback_ms;
 
     void *user; // kullanýcý verisi
     void (*on_event)(void *user, btn_event_t evt, unsigned index, unsigned gpio);
+
+    // Footprint (0/false = defaults)
+    unsigned stack_kb;    // worker thread stack in KiB (0 = libc default, usually 8 MB)
+    bool     lock_memory; // prefault + mlock engine state and worker stack
+
+    // Single-threaded mode: no worker/dispatcher threads. The caller waits on
+    // btns_get_fd() / btns_next_timeout_ms() and calls btns_process(); every
+    // on_event runs inside btns_process() (priority lanes are not used).
+    bool     no_threads;
+
+    // Callback budget: every on_event / subscriber call is timed (one
+    // CLOCK_MONOTONIC read before and after) into per-callback stats; a call
+    // longer than this counts as over budget and is reported as
+    // BTN_EVENT_OVERRUN (after that call has returned, never from inside
+    // it), at most once per second per callback. 0 = no timing.
+    unsigned cb_budget_us;
+
+    // Sharded edge processing (many chips/lines): pins are split into this
+    // many shards, each with its own thread that alone owns their state,
+    // debounce, timers and level reads. One merge thread then delivers all
+    // events, oldest first, and runs the idle check, so on_event never runs
+    // concurrently, every button's events keep their order and IDLE/ACTIVITY
+    // stay in order with them. 0/1 = off; ignored with no_threads.
+    unsigned shards;
 } btns_config_t;
 
 typedef struct btns_ctx btns_ctx_t;
 
+// Per-lane dispatch statistics (lanes exist when any pin is BTN_PRIO_CRITICAL;
+// latency = event generated -> on_event invoked)
+typedef struct {
+    uint64_t dispatched;
+    uint64_t dropped;          // lane queue full
+    uint64_t latency_max_ns;
+    uint64_t latency_sum_ns;   // mean = sum / dispatched
+} btns_lane_stats_t;
+
+// Timer wakeups (worker loop or btns_process calls); wakeups/s =
+// wakeups * 1000 / uptime_ms. late_max_ms: worst HOLD/REPEAT delay past its
+// deadline (bounded by timer_slack_ms + scheduling latency). cpu_ns: CPU
+// time of the worker and shard threads so far (0 with no_threads).
+typedef struct {
+    uint64_t wakeups;
+    uint64_t timers_fired;
+    uint32_t late_max_ms;
+    uint32_t uptime_ms;
+    uint64_t cpu_ns;
+} btns_timer_stats_t;
+
+typedef struct {
+    uint64_t frames;            // batches on a frame_fd tick
+    uint64_t holdback_flushes;  // batches forced by frame_holdback_ms
+    uint64_t events;
+    uint64_t dropped;           // frame buffer full
+    uint64_t latency_max_ns;    // buffered -> delivered
+} btns_frame_stats_t;
+
+// One shard (cfg.shards > 1). The full counters mean back-pressure, not loss:
+// the producer / shard waits for room.
+typedef struct {
+    uint32_t buttons;           // owned by this shard
+    uint64_t edges;             // processed by the shard thread
+    uint64_t events;            // handed to the merge stage
+    uint64_t in_full;           // edge ring full (backend callback waited)
+    uint64_t out_full;          // merge stage behind (shard waited)
+} btns_shard_stats_t;
+
 btns_ctx_t* btns_create(const btns_config_t *cfg);
 void        btns_destroy(btns_ctx_t *ctx);
 bool        btns_is_pressed(btns_ctx_t *ctx, unsigned index);
+int         btns_get_lane_stats(btns_ctx_t *ctx, unsigned prio, btns_lane_stats_t *out);
+int         btns_get_timer_stats(btns_ctx_t *ctx, btns_timer_stats_t *out);
+int         btns_get_frame_stats(btns_ctx_t *ctx, btns_frame_stats_t *out);
+// -1 unless sharded and shard < number of shards (min(cfg.shards, count))
+int         btns_get_shard_stats(btns_ctx_t *ctx, unsigned shard, btns_shard_stats_t *out);
+// Switch the debounce strategy at runtime (re-programs the glitch filter of
+// every line; the software check follows from the next edge). -1 if invalid.
+int         btns_set_debounce(btns_ctx_t *ctx, btns_debounce_t mode);
+// "both", "kernel", "software"; btns_debounce_parse: -1 if unknown
+const char *btns_debounce_name(btns_debounce_t mode);
+int         btns_debounce_parse(const char *name);
+
+// Per-callback execution time (cfg.cb_budget_us != 0). hist[k] counts calls
+// of 2^k .. 2^(k+1)-1 ns (k = 0 also holds 0 ns).
+#define BTNS_CB_HIST_BUCKETS 32
+typedef struct {
+    uint64_t calls;
+    uint64_t over_budget;
+    uint64_t overrun_events;   // BTN_EVENT_OVERRUN reported (rate limited)
+    uint64_t max_ns;
+    uint64_t sum_ns;
+    uint64_t hist[BTNS_CB_HIST_BUCKETS];
+} btns_cb_stats_t;
+
+// id: BTNS_CB_ON_EVENT or a btns_subscribe() id (also after unsubscribe).
+// -1 if unknown or timing is off.
+int         btns_get_cb_stats(btns_ctx_t *ctx, unsigned id, btns_cb_stats_t *out);
+// Upper bound (ns) of the bucket holding the p-th percentile, p in 0..100
+uint64_t    btns_cb_stats_percentile(const btns_cb_stats_t *s, double p);
+
+// Subscriptions: more consumers next to cfg.on_event, each with a button
+// bitmap ((count+63)/64 words, NULL = all) and an event-type mask. They are
+// compiled into one callback list per (event type, button), so an event only
+// reaches its subscribers; an event nobody wants is not queued. IDLE and
+// OVERRUN match on the event mask alone. Callbacks run where on_event would
+// (inline, lane dispatcher, frame batch). Returns an id >= 0, or -1. Meant
+// for setup time: every change recompiles the table and the old one is kept
+// until destroy.
+#define BTNS_EVT_BIT(e) (1u << (e))
+#define BTNS_EVT_ALL    0x7FEu   // BTN_EVENT_PRESS .. BTN_EVENT_OVERRUN
+typedef void (*btns_event_fn)(void *user, btn_event_t evt, unsigned index, unsigned gpio);
+int         btns_subscribe(btns_ctx_t *ctx, const uint64_t *buttons, uint32_t events,
+                           btns_event_fn fn, void *user);
+int         btns_unsubscribe(btns_ctx_t *ctx, int id);
+
+// no_threads mode. btns_get_fd: readable when edges are pending (-1 = the
+// backend has no fd; edges are then delivered while the caller drives the
+// lines). btns_next_timeout_ms: ms until the next HOLD/REPEAT/filter timer,
+// -1 = none. btns_process: waits up to timeout_ms (-1 = until the next timer
+// or edge, 0 = don't block), ingests edges, fires due timers and returns the
+// number of events delivered, or -1.
+int         btns_get_fd(btns_ctx_t *ctx);
+int         btns_next_timeout_ms(btns_ctx_t *ctx);
+int         btns_process(btns_ctx_t *ctx, int timeout_ms);
+
+// ---------- Bit-sliced debounce for sampled sources (matrix, shift register, polling) ----------
+// Vertical counters: every input bit has a small counter spread over bit-planes,
+// so one sample of 64 inputs is debounced with a handful of word operations.
+// An input toggles after `samples` consecutive samples differing from its state.
+#define BTNS_VDEBOUNCE_MAX_SAMPLES 15
+
+typedef struct btns_vdebounce btns_vdebounce_t;
+
+btns_vdebounce_t *btns_vdebounce_create(unsigned nbits, unsigned samples);
+void              btns_vdebounce_destroy(btns_vdebounce_t *vd);
+// raw: nbits-wide sample (bit set = pressed), (nbits+63)/64 words.
+// changed (optional, same size): bits toggled by this sample.
+// Returns the number of toggled inputs.
+unsigned          btns_vdebounce_update(btns_vdebounce_t *vd, const uint64_t *raw, uint64_t *changed);
+// Debounced state bitmap, (nbits+63)/64 words
+const uint64_t   *btns_vdebounce_state(const btns_vdebounce_t *vd, uint64_t *out);
+
+// Feed debounced changes into the event engine: for every set bit i of
+// changed[], button (first_index + i) goes to the level in state[]
+// (PRESS/RELEASE/CLICK now, HOLD/REPEAT from the worker as usual).
+int         btns_feed_changes(btns_ctx_t *ctx, unsigned first_index,
+                              const uint64_t *state, const uint64_t *changed, unsigned nbits);
+
+// ---------- Analog (Hall-effect) keys, rapid trigger (btns_analog.c) ----------
+// Travel is normalized per key to 0..BTNS_ANALOG_TRAVEL_MAX (rest..bottom).
+// Press: travel moved press_delta down from the highest point since the last
+// release. Release: moved release_delta up from the deepest point since the
+// press, or back inside the deadzone. State/changed bitmaps feed
+// btns_feed_changes() like the vertical debounce.
+#define BTNS_ANALOG_TRAVEL_MAX 1000
+
+typedef struct {
+    int32_t  raw_rest;       // ADC value at rest (released)
+    int32_t  raw_bottom;     // ADC value bottomed out (may be below raw_rest)
+    uint16_t deadzone;       // travel <= deadzone is always released
+    uint16_t press_delta;    // > noise, in travel units
+    uint16_t release_delta;
+} btns_analog_key_t;
+
+typedef struct btns_analog btns_analog_t;
+
+btns_analog_t  *btns_analog_create(const btns_analog_key_t *keys, unsigned n);
+void            btns_analog_destroy(btns_analog_t *a);
+// raw[i] = sample of key i. changed (optional, (n+63)/64 words): keys toggled
+// by this sample. Returns the number toggled.
+unsigned        btns_analog_update(btns_analog_t *a, const int32_t *raw, uint64_t *changed);
+const uint64_t *btns_analog_state(const btns_analog_t *a, uint64_t *out);
+// Current reference point (highest point released / deepest pressed)
+int             btns_analog_travel(const btns_analog_t *a, unsigned index);
+
+// Buffered IIO scans: channels x sample_bytes (1/2/4, signed LE) per scan,
+// plus an s64 timestamp aligned to 8 bytes if `timestamp` (skipped). Path is
+// /dev/iio:deviceN with scan elements and buffer enabled, or a regular file /
+// FIFO with the same layout as a stand-in. Negative errno on failure.
+typedef struct btns_iio btns_iio_t;
+
+btns_iio_t *btns_iio_open(const char *path, unsigned channels, unsigned sample_bytes, bool timestamp);
+void        btns_iio_close(btns_iio_t *io);
+int         btns_iio_fd(const btns_iio_t *io);
+// raw[scan * channels + ch]. Returns scans read (<= max_scans), 0 if none
+// pending, -ENODATA at end of a stand-in file.
+int         btns_iio_read(btns_iio_t *io, int32_t *raw, unsigned max_scans);
+
+// ---------- Snapshot diff (btns_scan.c) ----------
+// Edges between two nbits-wide snapshots (bit set = active), found with
+// SIMD (SSE2/AVX2/NEON) where available, scalar otherwise.
+typedef struct {
+    uint32_t index;    // bit index
+    uint8_t  rising;   // 1: 0->1, 0: 1->0
+} btns_edge_t;
+
+// Writes at most max_out edges in ascending index order, returns the count.
+// If the count equals max_out the scan may have stopped early.
+size_t      btns_scan_edges(const uint64_t *prev, const uint64_t *cur, size_t nbits,
+                            btns_edge_t *out, size_t max_out);
+// Active implementation name ("avx2", "sse2", "neon", "scalar")
+const char *btns_scan_impl(void);
+// Force an implementation (NULL = auto). -1 if unknown or unsupported.
+// Not thread-safe against concurrent btns_scan_edges().
+int         btns_scan_select(const char *name);
+
+// ---------- Low-level libgpiod line API (gpio_gpiod.c) ----------
+struct buttons_gpio_ctx;
+
+int  buttons_gpio_open(struct buttons_gpio_ctx **out,
+                       const char *chip_name,
+                       const unsigned *offsets,
+                       size_t count,
+                       bool active_low,
+                       unsigned debounce_ms,
+                       unsigned event_buf);
+// Same as buttons_gpio_open, but also requests output lines (LED, buzzer)
+// in the same line request so feedback costs no extra process or chip fd.
+int  buttons_gpio_open_ex(struct buttons_gpio_ctx **out,
+                          const char *chip_name,
+                          const unsigned *offsets,
+                          size_t count,
+                          bool active_low,
+                          unsigned debounce_ms,
+                          unsigned event_buf,
+                          const unsigned *out_offsets,
+                          size_t out_count,
+                          bool out_active_low);
+void buttons_gpio_close(struct buttons_gpio_ctx *ctx);
+int  buttons_gpio_poll(struct buttons_gpio_ctx *ctx, int timeout_ms,
+                       int (*on_event)(unsigned offset, bool rising, uint64_t ts_ns, void *user),
+                       void *user);
+int  buttons_gpio_read_level(struct buttons_gpio_ctx *ctx, unsigned offset, int *level_out);
+// File descriptor of the line request, readable when edge events are pending.
+// Lets callers multiplex GPIO with other fds and call buttons_gpio_poll(ctx, 0, ...).
+int  buttons_gpio_get_fd(struct buttons_gpio_ctx *ctx);
+
+// Output feedback: bind an input line to an output line that follows its
+// pressed state. Applied inside buttons_gpio_poll with one set_values ioctl
+// per event batch.
+int  buttons_gpio_set_feedback(struct buttons_gpio_ctx *ctx, unsigned in_offset, unsigned out_offset);
+// Stage an output value (e.g. hold feedback from an event callback). Staged
+// values are written by the next flush, or at the end of the current poll batch.
+int  buttons_gpio_output_stage(struct buttons_gpio_ctx *ctx, unsigned out_offset, bool on);
+int  buttons_gpio_output_flush(struct buttons_gpio_ctx *ctx);
+
+// ---------- Keypad pipeline (btns_pipeline.c, btns_sink.c) ----------
+// source -> filter (min-gap, turbo) -> mapper (line -> key) -> sink: the
+// keypad-hid event path as a library. Sources and sinks are small vtables, so
+// benchmarks inject edges and embedders take keys in-process (no uinput hop).
+// Single-threaded: one pipeline is driven from one thread.
+// Scope: there is no debounce or gesture stage. Debounce is the source's
+// job (kernel line debounce for GPIO, rapid trigger for IIO) and keys map
+// 1:1 to press/release; HOLD/CLICK/REPEAT need the event engine
+// (btns_create) on the lines instead.
+
+// Latency histogram: log2 buckets with 4 sub-buckets per octave
+#define BTNS_HIST_BUCKETS (64 << 2)
+typedef struct {
+    uint64_t b[BTNS_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} btns_hist_t;
+
+void     btns_hist_add(btns_hist_t *h, uint64_t ns);
+// Upper bound of the bucket holding the p-th percentile (p in 0..100)
+uint64_t btns_hist_percentile(const btns_hist_t *h, double p);
+
+typedef struct {
+    unsigned offset;     // source line (GPIO offset / IIO channel)
+    int      keycode;    // linux KEY_*, < 0 = line ignored
+    int      hid_usage;  // keyboard page usage, filled in for HID sinks
+    unsigned turbo_ms;   // autofire period while held, 0 = off
+} btns_keymap_t;
+
+// "off:key,..." (key: up/down/left/right/enter/esc or a KEY_* number)
+int btns_keymap_parse(const char *spec, btns_keymap_t *out, size_t max, size_t *count_out);
+// "off:period_ms,..." onto lines already in the map (-ENOENT: line not mapped)
+int btns_keymap_parse_turbo(const char *spec, btns_keymap_t *map, size_t count);
+int btns_key_to_hid_usage(int keycode);   // -EINVAL: no keyboard page usage
+
+typedef struct btns_pipe btns_pipe_t;
+
+// Sink: key() queues one transition into the current frame, flush() writes
+// the frame (uinput: events + one SYN_REPORT, uhid: one report). A key never
+// changes twice in one frame (the pipeline flushes first). fd >= 0 is polled
+// and service() called when readable (uhid kernel requests).
+typedef struct btns_sink {
+    int  (*key)(struct btns_sink *s, const btns_keymap_t *k, bool down);
+    int  (*flush)(struct btns_sink *s);
+    void (*service)(struct btns_sink *s);
+    void (*destroy)(struct btns_sink *s);
+    int  fd;
+    bool hid;            // uses btns_keymap_t.hid_usage
+} btns_sink_t;
+
+// Source: read() pushes the pending edges with btns_pipe_edge() and returns
+// how many, 0 if none, -ENODATA at end of input, or negative errno.
+typedef struct btns_source {
+    int  (*read)(struct btns_source *s, btns_pipe_t *p);
+    void (*destroy)(struct btns_source *s);
+    int  fd;
+} btns_source_t;
+
+typedef enum { BTNS_SINK_UINPUT = 0, BTNS_SINK_UHID } btns_sink_kind_t;
+
+// Virtual keyboard sinks; 0 or negative errno. null: same encoding and write()
+// path into /dev/null (load tests without a device). UHID returns once the
+// kernel has started the device (-ETIMEDOUT if it never does).
+int btns_sink_open(btns_sink_t **out, btns_sink_kind_t kind, const btns_keymap_t *map, size_t count);
+int btns_sink_null_open(btns_sink_t **out, btns_sink_kind_t kind);
+// In-process consumer: on_key per transition, on_flush (optional) per frame
+int btns_sink_callback_open(btns_sink_t **out, int (*on_key)(void *user, int keycode, bool down),
+                            int (*on_flush)(void *user), void *user);
+
+// Edges of an open line request (the context stays owned by the caller)
+int btns_source_gpio_open(btns_source_t **out, struct buttons_gpio_ctx *gpio);
+// Analog keys: IIO scans -> rapid trigger; channel c reports as offset c
+int btns_source_iio_open(btns_source_t **out, const char *path, unsigned channels,
+                         unsigned sample_bytes, bool timestamp, const btns_analog_key_t *key);
+
+typedef enum {
+    BTNS_PIPE_SENT = 0,
+    BTNS_PIPE_REPEATED,     // same level again, outside min_gap
+    BTNS_PIPE_SUPPRESSED,   // same level again within min_gap
+    BTNS_PIPE_UNMAPPED,
+    BTNS_PIPE_TURBO         // autofire toggle
+} btns_pipe_action_t;
+const char *btns_pipe_action_name(btns_pipe_action_t a);
+
+typedef struct {
+    const btns_keymap_t *map;    // copied
+    size_t   map_count;          // <= BUTTONS_MAX_LINES
+    unsigned min_gap_ms;         // same-level edges closer than this are dropped
+    btns_source_t *source;       // owned; NULL = caller pushes edges
+    btns_sink_t   *sink;         // owned
+    // Optional per-edge hook (trace, flight recorder); ts = edge or turbo deadline
+    void (*on_edge)(void *user, unsigned offset, int level, uint64_t ts_ns, btns_pipe_action_t a);
+    void *user;
+    bool lock_memory;            // mlock the pipeline state (best effort)
+} btns_pipe_config_t;
+
+typedef struct {
+    uint64_t edges;
+    uint64_t batches;        // non-empty source reads
+    uint64_t keys_sent;
+    uint64_t frames;         // sink flushes
+    uint64_t suppressed;
+    uint64_t unmapped;
+    uint64_t turbo;
+    uint64_t write_errors;
+} btns_pipe_stats_t;
+
+// fds to multiplex (-1 = unused); call btns_pipe_handle(p, which) when readable
+enum { BTNS_PIPE_FD_SOURCE = 0, BTNS_PIPE_FD_SINK, BTNS_PIPE_FD_TURBO, BTNS_PIPE_NFDS };
+
+btns_pipe_t *btns_pipe_create(const btns_pipe_config_t *cfg);   // NULL + errno
+void btns_pipe_destroy(btns_pipe_t *p);
+int  btns_pipe_fd(const btns_pipe_t *p, unsigned which);
+// source: read + flush, sink: service, turbo: due autofire toggles.
+// Negative errno on failure, -ENODATA once the source has ended.
+int  btns_pipe_handle(btns_pipe_t *p, unsigned which);
+// Inject one edge (ts_ns: CLOCK_MONOTONIC); btns_pipe_on_edge has the
+// buttons_gpio_poll() callback shape (user = pipeline).
+int  btns_pipe_edge(btns_pipe_t *p, unsigned offset, bool rising, uint64_t ts_ns);
+int  btns_pipe_on_edge(unsigned offset, bool rising, uint64_t ts_ns, void *pipe);
+int  btns_pipe_flush(btns_pipe_t *p);   // end of a batch: write the frame, re-arm turbo
+void btns_pipe_get_stats(const btns_pipe_t *p, btns_pipe_stats_t *out);
+// Edge timestamp (turbo: deadline) -> frame written
+const btns_hist_t *btns_pipe_latency(const btns_pipe_t *p);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: MIT
+// Analog (Hall-effect) keys: rapid-trigger actuation + buffered IIO reader
+// Notes:
+// - Rapid trigger: a key presses after moving press_delta down from its
+//   highest point since release, and releases after moving release_delta up
+//   from its deepest point since press; no fixed actuation point
+// - Travel is normalized to 0..BTNS_ANALOG_TRAVEL_MAX from the per-key
+//   rest/bottom calibration, so deltas do not depend on ADC resolution/polarity
+// - IIO reader: fixed scan layout (signed LE samples, optional s64 timestamp
+//   aligned to 8 bytes). A regular file or FIFO with the same layout works as
+//   a stand-in; a real device needs its scan elements and buffer enabled first
+// - Pipeline source: toggled keys become edges stamped with the read time
+//   (the scan timestamp clock is not guaranteed to be CLOCK_MONOTONIC)
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "buttons.h"
+
+#define BTNS_IIO_READ_SCANS 64   // internal buffer, in scans
+
+struct analog_key {
+    btns_analog_key_t cfg;
+    int      span;       // raw_bottom - raw_rest (signed)
+    uint16_t extreme;    // released: highest point, pressed: deepest point
+    bool     pressed;
+};
+
+struct btns_analog {
+    unsigned           n;
+    unsigned           words;
+    struct analog_key *k;
+    uint64_t          *state;
+};
+
+btns_analog_t *btns_analog_create(const btns_analog_key_t *keys, unsigned n)
+{
+    if (!keys || n == 0) return NULL;
+    btns_analog_t *a = calloc(1, sizeof(*a));
+    if (!a) return NULL;
+    a->n = n;
+    a->words = (n + 63) / 64;
+    a->k = calloc(n, sizeof(*a->k));
+    a->state = calloc(a->words, sizeof(uint64_t));
+    if (!a->k || !a->state) { btns_analog_destroy(a); return NULL; }
+    for (unsigned i = 0; i < n; i++) {
+        a->k[i].cfg = keys[i];
+        a->k[i].span = keys[i].raw_bottom - keys[i].raw_rest;
+        if (a->k[i].span == 0) a->k[i].span = 1;
+    }
+    return a;
+}
+
+void btns_analog_destroy(btns_analog_t *a)
+{
+    if (!a) return;
+    free(a->k);
+    free(a->state);
+    free(a);
+}
+
+static uint16_t travel_of(const struct analog_key *k, int32_t raw)
+{
+    int64_t t = (int64_t)(raw - k->cfg.raw_rest) * BTNS_ANALOG_TRAVEL_MAX / k->span;
+    if (t < 0) t = 0;
+    if (t > BTNS_ANALOG_TRAVEL_MAX) t = BTNS_ANALOG_TRAVEL_MAX;
+    return (uint16_t)t;
+}
+
+unsigned btns_analog_update(btns_analog_t *a, const int32_t *raw, uint64_t *changed)
+{
+    unsigned toggled = 0;
+    if (changed) memset(changed, 0, a->words * sizeof(uint64_t));
+    for (unsigned i = 0; i < a->n; i++) {
+        struct analog_key *k = &a->k[i];
+        uint16_t t = travel_of(k, raw[i]);
+        bool flip;
+        if (!k->pressed) {
+            if (t < k->extreme) k->extreme = t;
+            flip = t > k->cfg.deadzone && t >= k->extreme + k->cfg.press_delta;
+        } else {
+            if (t > k->extreme) k->extreme = t;
+            flip = t <= k->cfg.deadzone || t + k->cfg.release_delta <= k->extreme;
+        }
+        if (!flip) continue;
+        k->pressed = !k->pressed;
+        k->extreme = t;   // direction reversed: track from here
+        a->state[i / 64] ^= 1ull << (i % 64);
+        if (changed) changed[i / 64] |= 1ull << (i % 64);
+        toggled++;
+    }
+    return toggled;
+}
+
+const uint64_t *btns_analog_state(const btns_analog_t *a, uint64_t *out)
+{
+    memcpy(out, a->state, a->words * sizeof(uint64_t));
+    return out;
+}
+
+int btns_analog_travel(const btns_analog_t *a, unsigned index)
+{
+    if (!a || index >= a->n) return -EINVAL;
+    return a->k[index].extreme;
+}
+
+// ---------- Buffered IIO reader ----------
+struct btns_iio {
+    int      fd;
+    unsigned channels;
+    unsigned sample_bytes;
+    size_t   scan_bytes;
+    size_t   have;     // bytes buffered (partial scan carried over)
+    uint8_t *buf;
+};
+
+btns_iio_t *btns_iio_open(const char *path, unsigned channels, unsigned sample_bytes, bool timestamp)
+{
+    if (!path || channels == 0 || (sample_bytes != 1 && sample_bytes != 2 && sample_bytes != 4)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    btns_iio_t *io = calloc(1, sizeof(*io));
+    if (!io) return NULL;
+    io->channels = channels;
+    io->sample_bytes = sample_bytes;
+    io->scan_bytes = (size_t)channels * sample_bytes;
+    if (timestamp) io->scan_bytes = ((io->scan_bytes + 7) & ~(size_t)7) + 8;
+    io->buf = malloc(io->scan_bytes * BTNS_IIO_READ_SCANS);
+    io->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (!io->buf || io->fd < 0) {
+        int e = errno;
+        btns_iio_close(io);
+        errno = e;
+        return NULL;
+    }
+    return io;
+}
+
+void btns_iio_close(btns_iio_t *io)
+{
+    if (!io) return;
+    if (io->fd >= 0) close(io->fd);
+    free(io->buf);
+    free(io);
+}
+
+int btns_iio_fd(const btns_iio_t *io)
+{
+    return io ? io->fd : -EINVAL;
+}
+
+static int32_t sample_at(const uint8_t *p, unsigned bytes)
+{
+    switch (bytes) {
+    case 1:  return (int8_t)p[0];
+    case 2:  return (int16_t)(uint16_t)(p[0] | p[1] << 8);
+    default: return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                              (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+    }
+}
+
+int btns_iio_read(btns_iio_t *io, int32_t *raw, unsigned max_scans)
+{
+    if (!io || !raw || max_scans == 0) return -EINVAL;
+    if (max_scans > BTNS_IIO_READ_SCANS) max_scans = BTNS_IIO_READ_SCANS;
+
+    size_t want = io->scan_bytes * max_scans - io->have;
+    ssize_t r = read(io->fd, io->buf + io->have, want);
+    if (r < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -errno;
+    if (r == 0 && io->have < io->scan_bytes) return -ENODATA;   // end of stand-in file
+    io->have += (size_t)r;
+
+    unsigned scans = (unsigned)(io->have / io->scan_bytes);
+    for (unsigned s = 0; s < scans; s++) {
+        const uint8_t *p = io->buf + (size_t)s * io->scan_bytes;
+        for (unsigned c = 0; c < io->channels; c++)
+            raw[(size_t)s * io->channels + c] = sample_at(p + (size_t)c * io->sample_bytes, io->sample_bytes);
+    }
+    size_t used = (size_t)scans * io->scan_bytes;
+    memmove(io->buf, io->buf + used, io->have - used);
+    io->have -= used;
+    return (int)scans;
+}
+
+// ---------- Pipeline source ----------
+#define IIO_SOURCE_SCANS 64
+
+struct iio_source {
+    btns_source_t  base;
+    btns_iio_t    *io;
+    btns_analog_t *an;
+    unsigned       channels;
+    int32_t        raw[IIO_SOURCE_SCANS * BUTTONS_MAX_LINES];
+};
+
+static int iio_source_read(btns_source_t *s, btns_pipe_t *p)
+{
+    struct iio_source *src = (struct iio_source *)s;
+    uint64_t changed[(BUTTONS_MAX_LINES + 63) / 64], state[(BUTTONS_MAX_LINES + 63) / 64];
+    int n = btns_iio_read(src->io, src->raw, IIO_SOURCE_SCANS);
+    if (n <= 0) return n;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t t = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    int edges = 0;
+    for (int k = 0; k < n; k++) {
+        if (!btns_analog_update(src->an, &src->raw[(size_t)k * src->channels], changed)) continue;
+        btns_analog_state(src->an, state);
+        for (unsigned c = 0; c < src->channels; c++) {
+            if (!(changed[c / 64] >> (c % 64) & 1)) continue;
+            int rc = btns_pipe_edge(p, c, (state[c / 64] >> (c % 64)) & 1, t);
+            if (rc) return rc;
+            edges++;
+        }
+    }
+    return edges;
+}
+
+static void iio_source_destroy(btns_source_t *s)
+{
+    struct iio_source *src = (struct iio_source *)s;
+    btns_iio_close(src->io);
+    btns_analog_destroy(src->an);
+    free(src);
+}
+
+int btns_source_iio_open(btns_source_t **out, const char *path, unsigned channels,
+                         unsigned sample_bytes, bool timestamp, const btns_analog_key_t *key)
+{
+    if (!out || !key || channels == 0 || channels > BUTTONS_MAX_LINES) return -EINVAL;
+    struct iio_source *src = calloc(1, sizeof(*src));
+    if (!src) return -ENOMEM;
+    btns_analog_key_t keys[BUTTONS_MAX_LINES];
+    for (unsigned c = 0; c < channels; c++) keys[c] = *key;
+    src->channels = channels;
+    src->an = btns_analog_create(keys, channels);
+    src->io = btns_iio_open(path, channels, sample_bytes, timestamp);
+    if (!src->an || !src->io) {
+        int rc = -(errno ? errno : ENOMEM);
+        iio_source_destroy(&src->base);
+        return rc;
+    }
+    src->base.read = iio_source_read;
+    src->base.destroy = iio_source_destroy;
+    src->base.fd = btns_iio_fd(src->io);
+    *out = &src->base;
+    return 0;
+}
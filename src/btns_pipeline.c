@@ -0,0 +1,425 @@
+// SPDX-License-Identifier: MIT
+// Keypad pipeline: source -> filter (min-gap, turbo) -> mapper -> sink
+// Notes:
+// - The keypad-hid event path as a library; keypad-hid, btns-bench and
+//   embedding daemons all drive the same code
+// - Keys changed while a batch is processed are queued into one sink frame;
+//   latency is taken when the frame has been written
+// - Turbo keys toggle on an absolute timerfd deadline anchored to the press;
+//   a deadline missed by whole periods drops those pairs
+// - Not thread-safe: one pipeline per thread (or external locking)
+// - No debounce/gesture stage: sources deliver debounced edges (kernel line
+//   debounce, rapid trigger) and min-gap only drops repeated levels
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <linux/input.h>
+#include "buttons.h"
+
+#define HIST_SUB_BITS 2
+
+// ---------- Latency histogram ----------
+static unsigned hist_bucket(uint64_t ns)
+{
+    if (ns < (1u << HIST_SUB_BITS)) return (unsigned)ns;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(ns);
+    unsigned sub = (unsigned)(ns >> (msb - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1);
+    return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + sub;
+}
+
+static uint64_t hist_bucket_upper(unsigned k)
+{
+    if (k < (1u << HIST_SUB_BITS)) return k;
+    unsigned msb  = (k >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    uint64_t sub  = k & ((1u << HIST_SUB_BITS) - 1);
+    uint64_t step = 1ull << (msb - HIST_SUB_BITS);
+    return (((1ull << HIST_SUB_BITS) + sub) << (msb - HIST_SUB_BITS)) + step - 1;
+}
+
+void btns_hist_add(btns_hist_t *h, uint64_t ns)
+{
+    h->b[hist_bucket(ns)]++;
+    h->count++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+}
+
+uint64_t btns_hist_percentile(const btns_hist_t *h, double p)
+{
+    if (!h->count) return 0;
+    uint64_t want = (uint64_t)((double)h->count * p / 100.0 + 0.999999);
+    if (want == 0) want = 1;
+    uint64_t acc = 0;
+    for (unsigned k = 0; k < BTNS_HIST_BUCKETS; k++) {
+        acc += h->b[k];
+        if (acc >= want) {
+            uint64_t up = hist_bucket_upper(k);
+            return up < h->max_ns ? up : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+// ---------- Key map ----------
+static int keyname_to_code(const char *name)
+{
+    if (strcasecmp(name, "up")    == 0) return KEY_UP;
+    if (strcasecmp(name, "down")  == 0) return KEY_DOWN;
+    if (strcasecmp(name, "left")  == 0) return KEY_LEFT;
+    if (strcasecmp(name, "right") == 0) return KEY_RIGHT;
+    if (strcasecmp(name, "enter") == 0) return KEY_ENTER;
+    if (strcasecmp(name, "esc")   == 0 || strcasecmp(name, "escape") == 0) return KEY_ESC;
+
+    char *end = NULL;
+    long v = strtol(name, &end, 0);
+    if (end && *end == '\0' && v > 0 && v < 1024) return (int)v;
+
+    return -EINVAL;
+}
+
+int btns_keymap_parse(const char *spec, btns_keymap_t *out, size_t max, size_t *count_out)
+{
+    if (!spec || !out || !count_out) return -EINVAL;
+    char *tmp = strdup(spec);
+    if (!tmp) return -ENOMEM;
+
+    size_t n = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(tmp, ",", &save);
+         tok && n < max;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        char *colon = strchr(tok, ':');
+        if (!colon) { free(tmp); return -EINVAL; }
+        *colon = '\0';
+        const char *s_off = tok;
+        const char *s_key = colon + 1;
+
+        char *e1 = NULL;
+        long off = strtol(s_off, &e1, 0);
+        if (!e1 || *e1 != '\0' || off < 0 || off > 1023) { free(tmp); return -EINVAL; }
+
+        int code = keyname_to_code(s_key);
+        if (code < 0) { free(tmp); return -EINVAL; }
+
+        memset(&out[n], 0, sizeof(out[n]));
+        out[n].offset    = (unsigned)off;
+        out[n].keycode   = code;
+        out[n].hid_usage = -1;
+        n++;
+    }
+
+    free(tmp);
+    *count_out = n;
+    return (n > 0) ? 0 : -EINVAL;
+}
+
+int btns_keymap_parse_turbo(const char *spec, btns_keymap_t *map, size_t count)
+{
+    if (!spec || !map) return -EINVAL;
+    char *tmp = strdup(spec);
+    if (!tmp) return -ENOMEM;
+    int rc = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(tmp, ",", &save); tok && !rc; tok = strtok_r(NULL, ",", &save)) {
+        char *e1 = NULL, *e2 = NULL;
+        long off = strtol(tok, &e1, 0);
+        long ms = (e1 && *e1 == ':') ? strtol(e1 + 1, &e2, 0) : -1;
+        if (!e2 || *e2 != '\0' || ms < 2 || ms > 10000) { rc = -EINVAL; break; }
+        size_t i = 0;
+        while (i < count && map[i].offset != (unsigned)off) i++;
+        if (i == count) rc = -ENOENT;
+        else map[i].turbo_ms = (unsigned)ms;
+    }
+    free(tmp);
+    return rc;
+}
+
+// Keyboard page usage -> Linux keycode (same table as the kernel's hid-input)
+static const uint8_t HID_USAGE_TO_KEY[0x74] = {
+      0,  0,  0,  0, 30, 48, 46, 32, 18, 33, 34, 35, 23, 36, 37, 38,
+     50, 49, 24, 25, 16, 19, 31, 20, 22, 47, 17, 45, 21, 44,  2,  3,
+      4,  5,  6,  7,  8,  9, 10, 11, 28,  1, 14, 15, 57, 12, 13, 26,
+     27, 43, 43, 39, 40, 41, 51, 52, 53, 58, 59, 60, 61, 62, 63, 64,
+     65, 66, 67, 68, 87, 88, 99, 70,119,110,102,104,111,107,109,106,
+    105,108,103, 69, 98, 55, 74, 78, 96, 79, 80, 81, 75, 76, 77, 71,
+     72, 73, 82, 83, 86,127,116,117,183,184,185,186,187,188,189,190,
+    191,192,193,194,
+};
+static const uint8_t HID_MOD_TO_KEY[8] = { 29, 42, 56, 125, 97, 54, 100, 126 };  // 0xE0..0xE7
+
+int btns_key_to_hid_usage(int keycode)
+{
+    for (int m = 0; m < 8; m++)
+        if (HID_MOD_TO_KEY[m] == keycode) return 0xE0 + m;
+    for (int u = 4; u < (int)sizeof(HID_USAGE_TO_KEY); u++)
+        if (HID_USAGE_TO_KEY[u] == keycode) return u;
+    return -EINVAL;
+}
+
+// ---------- Pipeline ----------
+static const char *const ACTION_NAMES[] = { "sent", "repeated", "suppressed", "unmapped", "turbo" };
+
+const char *btns_pipe_action_name(btns_pipe_action_t a)
+{
+    return (unsigned)a < sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]) ? ACTION_NAMES[a] : "?";
+}
+
+struct pipe_line {
+    uint64_t last_ts_ns;     // last edge timestamp
+    int      last_level;     // -1 unknown, 0 released, 1 pressed
+    bool     turbo_up;       // autofire: reported up while held
+    uint64_t turbo_next_ns;
+};
+
+struct btns_pipe {
+    btns_keymap_t     map[BUTTONS_MAX_LINES];
+    size_t            map_count;
+    uint64_t          gap_ns;
+    btns_source_t    *src;
+    btns_sink_t      *sink;
+    void            (*on_edge)(void *user, unsigned offset, int level, uint64_t ts_ns, btns_pipe_action_t a);
+    void             *user;
+
+    struct pipe_line  line[BUTTONS_MAX_LINES];
+    uint64_t          touched;                   // map indices in the pending frame
+    uint64_t          pend_ts[BUTTONS_MAX_LINES];
+    unsigned          npend;
+
+    int               turbo_fd;                  // -1 = no turbo keys
+    bool              turbo_dirty;               // a turbo key changed: re-arm
+
+    btns_pipe_stats_t st;
+    btns_hist_t       lat;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void trace(btns_pipe_t *p, unsigned offset, int level, uint64_t ts_ns, btns_pipe_action_t a)
+{
+    if (p->on_edge) p->on_edge(p->user, offset, level, ts_ns, a);
+}
+
+btns_pipe_t *btns_pipe_create(const btns_pipe_config_t *cfg)
+{
+    if (!cfg || !cfg->sink || !cfg->map || cfg->map_count == 0 || cfg->map_count > BUTTONS_MAX_LINES) {
+        errno = EINVAL;
+        return NULL;
+    }
+    btns_pipe_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    memcpy(p->map, cfg->map, cfg->map_count * sizeof(p->map[0]));
+    p->map_count = cfg->map_count;
+    p->gap_ns = (uint64_t)cfg->min_gap_ms * 1000000ull;
+    p->on_edge = cfg->on_edge;
+    p->user = cfg->user;
+    p->turbo_fd = -1;
+
+    bool turbo = false;
+    for (size_t i = 0; i < p->map_count; i++) {
+        p->line[i].last_level = -1;
+        if (p->map[i].turbo_ms) turbo = true;
+        if (cfg->sink->hid && p->map[i].keycode > 0) {
+            p->map[i].hid_usage = btns_key_to_hid_usage(p->map[i].keycode);
+            if (p->map[i].hid_usage < 0) { free(p); errno = EINVAL; return NULL; }
+        }
+    }
+    if (turbo) {
+        p->turbo_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (p->turbo_fd < 0) { int e = errno; free(p); errno = e; return NULL; }
+    }
+    if (cfg->lock_memory) mlock(p, sizeof(*p));   // best effort (RLIMIT_MEMLOCK)
+    // Owned from here on
+    p->src = cfg->source;
+    p->sink = cfg->sink;
+    return p;
+}
+
+void btns_pipe_destroy(btns_pipe_t *p)
+{
+    if (!p) return;
+    if (p->src) p->src->destroy(p->src);
+    if (p->sink) p->sink->destroy(p->sink);
+    if (p->turbo_fd >= 0) close(p->turbo_fd);
+    free(p);
+}
+
+int btns_pipe_fd(const btns_pipe_t *p, unsigned which)
+{
+    if (!p) return -EINVAL;
+    switch (which) {
+    case BTNS_PIPE_FD_SOURCE: return p->src ? p->src->fd : -1;
+    case BTNS_PIPE_FD_SINK:   return p->sink->fd;
+    case BTNS_PIPE_FD_TURBO:  return p->turbo_fd;
+    default:                  return -EINVAL;
+    }
+}
+
+int btns_pipe_flush(btns_pipe_t *p)
+{
+    int rc = 0;
+    if (p->npend) {
+        rc = p->sink->flush ? p->sink->flush(p->sink) : 0;
+        p->touched = 0;
+        if (rc) {
+            p->st.write_errors++;
+        } else {
+            p->st.frames++;
+            uint64_t done = now_ns();
+            for (unsigned i = 0; i < p->npend; i++)
+                if (done >= p->pend_ts[i]) btns_hist_add(&p->lat, done - p->pend_ts[i]);
+        }
+        p->npend = 0;
+    }
+    if (p->turbo_dirty) {
+        p->turbo_dirty = false;
+        uint64_t next = 0;
+        for (size_t i = 0; i < p->map_count; i++) {
+            if (!p->map[i].turbo_ms || p->line[i].last_level != 1) continue;
+            if (!next || p->line[i].turbo_next_ns < next) next = p->line[i].turbo_next_ns;
+        }
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));   // next == 0: disarm
+        its.it_value.tv_sec = (time_t)(next / 1000000000ull);
+        its.it_value.tv_nsec = (long)(next % 1000000000ull);
+        timerfd_settime(p->turbo_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    }
+    return rc;
+}
+
+// Queue a transition of map[idx]; a key already in the pending frame forces
+// the frame out first (press and release in one frame would cancel out).
+static int queue_key(btns_pipe_t *p, size_t idx, int level, uint64_t ts_ns)
+{
+    if (p->touched & (1ull << idx)) {
+        int rc = btns_pipe_flush(p);
+        if (rc) return rc;
+    }
+    int rc = p->sink->key(p->sink, &p->map[idx], level != 0);
+    if (rc) { p->st.write_errors++; return rc; }
+    p->touched |= 1ull << idx;
+    p->pend_ts[p->npend++] = ts_ns;
+    return 0;
+}
+
+int btns_pipe_edge(btns_pipe_t *p, unsigned offset, bool rising, uint64_t ts_ns)
+{
+    int level = rising ? 1 : 0;
+
+    p->st.edges++;
+
+    size_t idx = SIZE_MAX;
+    for (size_t i = 0; i < p->map_count; i++)
+        if (p->map[i].offset == offset) { idx = i; break; }
+    if (idx == SIZE_MAX || p->map[idx].keycode < 0) {
+        p->st.unmapped++;
+        trace(p, offset, level, ts_ns, BTNS_PIPE_UNMAPPED);
+        return 0;
+    }
+
+    struct pipe_line *st = &p->line[idx];
+    if (st->last_level == level) {
+        if (st->last_ts_ns != 0 && ts_ns - st->last_ts_ns < p->gap_ns) {
+            p->st.suppressed++;
+            trace(p, offset, level, ts_ns, BTNS_PIPE_SUPPRESSED);
+            return 0; // suppress same-kind spam within min-gap
+        }
+        st->last_ts_ns = ts_ns;
+        trace(p, offset, level, ts_ns, BTNS_PIPE_REPEATED);
+        return 0;
+    }
+
+    // Autofire may already have reported the key up
+    int rc = (level || !st->turbo_up) ? queue_key(p, idx, level, ts_ns) : 0;
+    if (rc) return rc;
+    st->turbo_up = false;
+    if (p->map[idx].turbo_ms) {
+        if (level) st->turbo_next_ns = now_ns() + (uint64_t)p->map[idx].turbo_ms * 500000ull;
+        p->turbo_dirty = true;
+    }
+    st->last_level = level;
+    st->last_ts_ns = ts_ns;
+    p->st.keys_sent++;
+    trace(p, offset, level, ts_ns, BTNS_PIPE_SENT);
+    return 0;
+}
+
+int btns_pipe_on_edge(unsigned offset, bool rising, uint64_t ts_ns, void *pipe)
+{
+    return btns_pipe_edge((btns_pipe_t *)pipe, offset, rising, ts_ns);
+}
+
+// All toggles due now go out in one frame
+static int turbo_run(btns_pipe_t *p)
+{
+    uint64_t exp;
+    while (read(p->turbo_fd, &exp, sizeof(exp)) > 0) {}
+
+    uint64_t now = now_ns();
+    int rc = 0;
+    for (size_t i = 0; i < p->map_count && !rc; i++) {
+        const btns_keymap_t *k = &p->map[i];
+        struct pipe_line *st = &p->line[i];
+        if (!k->turbo_ms || st->last_level != 1 || st->turbo_next_ns > now) continue;
+        uint64_t half = (uint64_t)k->turbo_ms * 500000ull;
+        uint64_t due = st->turbo_next_ns;
+        int level = st->turbo_up ? 1 : 0;
+        rc = queue_key(p, i, level, due);
+        if (rc) break;
+        st->turbo_up = !st->turbo_up;
+        st->turbo_next_ns += half;
+        while (st->turbo_next_ns <= now) st->turbo_next_ns += 2 * half;
+        p->st.turbo++;
+        p->st.keys_sent++;
+        trace(p, k->offset, level, due, BTNS_PIPE_TURBO);
+    }
+    p->turbo_dirty = true;
+    int frc = btns_pipe_flush(p);
+    return rc ? rc : frc;
+}
+
+int btns_pipe_handle(btns_pipe_t *p, unsigned which)
+{
+    if (!p) return -EINVAL;
+    switch (which) {
+    case BTNS_PIPE_FD_SOURCE: {
+        if (!p->src) return -EINVAL;
+        int n = p->src->read(p->src, p);
+        if (n > 0) p->st.batches++;
+        int rc = btns_pipe_flush(p);
+        if (n < 0) return n;
+        return rc ? rc : n;
+    }
+    case BTNS_PIPE_FD_SINK:
+        if (p->sink->service) p->sink->service(p->sink);
+        return 0;
+    case BTNS_PIPE_FD_TURBO:
+        return p->turbo_fd >= 0 ? turbo_run(p) : 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+void btns_pipe_get_stats(const btns_pipe_t *p, btns_pipe_stats_t *out)
+{
+    *out = p->st;
+}
+
+const btns_hist_t *btns_pipe_latency(const btns_pipe_t *p)
+{
+    return &p->lat;
+}
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: MIT
+// Snapshot diff + edge extraction for bitmap-sampled inputs
+// Notes:
+// - XOR prev/cur snapshots, skip all-zero blocks with SIMD, then pull the set
+//   bits of each non-zero word out with ctz
+// - Implementations: scalar, SSE2 / AVX2 (x86), NEON (ARM). The best one the
+//   CPU supports is picked once, on first use
+// - Snapshots are uint64_t words, bit i = input i (1 = active)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "buttons.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BTNS_SCAN_X86 1
+#endif
+
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_NEON))
+#include <arm_neon.h>
+#define BTNS_SCAN_NEON 1
+#if defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+// Scans words [w, end) and appends to out[n..max_out); returns the new count
+// and leaves *wp at the first word not scanned (SIMD kernels stop at the last
+// full block, the scalar loop finishes the tail).
+typedef size_t (*scan_fn)(const uint64_t *prev, const uint64_t *cur, size_t *wp, size_t end,
+                          size_t nbits, btns_edge_t *out, size_t n, size_t max_out);
+
+static inline size_t extract_word(uint64_t diff, uint64_t cur, size_t w, size_t nbits,
+                                  btns_edge_t *out, size_t n, size_t max_out)
+{
+    while (diff && n < max_out) {
+        unsigned bit = (unsigned)__builtin_ctzll(diff);
+        size_t idx = w * 64 + bit;
+        if (idx >= nbits) break;   // padding bits of the last word
+        out[n].index  = (uint32_t)idx;
+        out[n].rising = (uint8_t)((cur >> bit) & 1u);
+        n++;
+        diff &= diff - 1;
+    }
+    return n;
+}
+
+static size_t scan_scalar(const uint64_t *prev, const uint64_t *cur, size_t *wp, size_t end,
+                          size_t nbits, btns_edge_t *out, size_t n, size_t max_out)
+{
+    size_t w = *wp;
+    for (; w < end && n < max_out; w++) {
+        uint64_t d = prev[w] ^ cur[w];
+        if (d) n = extract_word(d, cur[w], w, nbits, out, n, max_out);
+    }
+    *wp = w;
+    return n;
+}
+
+#ifdef BTNS_SCAN_X86
+__attribute__((target("sse2")))
+static size_t scan_sse2(const uint64_t *prev, const uint64_t *cur, size_t *wp, size_t end,
+                        size_t nbits, btns_edge_t *out, size_t n, size_t max_out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t w = *wp;
+    for (; w + 4 <= end && n < max_out; w += 4) {
+        __m128i d0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&prev[w]),
+                                   _mm_loadu_si128((const __m128i *)&cur[w]));
+        __m128i d1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&prev[w + 2]),
+                                   _mm_loadu_si128((const __m128i *)&cur[w + 2]));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(d0, d1), zero)) == 0xFFFF)
+            continue;   // 256 quiet inputs
+        for (size_t k = w; k < w + 4; k++) {
+            uint64_t d = prev[k] ^ cur[k];
+            if (d) n = extract_word(d, cur[k], k, nbits, out, n, max_out);
+        }
+    }
+    *wp = w;
+    return n;
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const uint64_t *prev, const uint64_t *cur, size_t *wp, size_t end,
+                        size_t nbits, btns_edge_t *out, size_t n, size_t max_out)
+{
+    size_t w = *wp;
+    for (; w + 8 <= end && n < max_out; w += 8) {
+        __m256i d0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&prev[w]),
+                                      _mm256_loadu_si256((const __m256i *)&cur[w]));
+        __m256i d1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&prev[w + 4]),
+                                      _mm256_loadu_si256((const __m256i *)&cur[w + 4]));
+        __m256i d = _mm256_or_si256(d0, d1);
+        if (_mm256_testz_si256(d, d))
+            continue;   // 512 quiet inputs
+        for (size_t k = w; k < w + 8; k++) {
+            uint64_t x = prev[k] ^ cur[k];
+            if (x) n = extract_word(x, cur[k], k, nbits, out, n, max_out);
+        }
+    }
+    *wp = w;
+    return n;
+}
+#endif
+
+#ifdef BTNS_SCAN_NEON
+static size_t scan_neon(const uint64_t *prev, const uint64_t *cur, size_t *wp, size_t end,
+                        size_t nbits, btns_edge_t *out, size_t n, size_t max_out)
+{
+    size_t w = *wp;
+    for (; w + 4 <= end && n < max_out; w += 4) {
+        uint64x2_t d0 = veorq_u64(vld1q_u64(&prev[w]), vld1q_u64(&cur[w]));
+        uint64x2_t d1 = veorq_u64(vld1q_u64(&prev[w + 2]), vld1q_u64(&cur[w + 2]));
+        uint64x2_t d = vorrq_u64(d0, d1);
+        if ((vgetq_lane_u64(d, 0) | vgetq_lane_u64(d, 1)) == 0)
+            continue;   // 256 quiet inputs
+        for (size_t k = w; k < w + 4; k++) {
+            uint64_t x = prev[k] ^ cur[k];
+            if (x) n = extract_word(x, cur[k], k, nbits, out, n, max_out);
+        }
+    }
+    *wp = w;
+    return n;
+}
+#endif
+
+struct scan_impl {
+    const char *name;
+    scan_fn     fn;
+    bool      (*supported)(void);
+};
+
+static bool cpu_any(void) { return true; }
+#ifdef BTNS_SCAN_X86
+static bool cpu_sse2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("sse2"); }
+static bool cpu_avx2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx2"); }
+#endif
+#ifdef BTNS_SCAN_NEON
+#if defined(__arm__)
+static bool cpu_neon(void) { return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0; }
+#else
+static bool cpu_neon(void) { return true; }   // mandatory on AArch64
+#endif
+#endif
+
+// Preference order: first supported entry wins
+static const struct scan_impl IMPLS[] = {
+#ifdef BTNS_SCAN_X86
+    { "avx2",   scan_avx2,   cpu_avx2 },
+    { "sse2",   scan_sse2,   cpu_sse2 },
+#endif
+#ifdef BTNS_SCAN_NEON
+    { "neon",   scan_neon,   cpu_neon },
+#endif
+    { "scalar", scan_scalar, cpu_any },
+};
+#define NIMPLS (sizeof(IMPLS) / sizeof(IMPLS[0]))
+
+static const struct scan_impl *g_impl;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static void pick_impl(void)
+{
+    for (size_t i = 0; i < NIMPLS; i++)
+        if (IMPLS[i].supported()) { g_impl = &IMPLS[i]; return; }
+}
+
+int btns_scan_select(const char *name)
+{
+    pthread_once(&g_once, pick_impl);
+    if (!name) { g_impl = NULL; pick_impl(); return 0; }
+    for (size_t i = 0; i < NIMPLS; i++) {
+        if (strcmp(IMPLS[i].name, name)) continue;
+        if (!IMPLS[i].supported()) return -1;
+        g_impl = &IMPLS[i];
+        return 0;
+    }
+    return -1;
+}
+
+const char *btns_scan_impl(void)
+{
+    pthread_once(&g_once, pick_impl);
+    return g_impl->name;
+}
+
+size_t btns_scan_edges(const uint64_t *prev, const uint64_t *cur, size_t nbits,
+                       btns_edge_t *out, size_t max_out)
+{
+    if (!prev || !cur || !out || max_out == 0 || nbits == 0) return 0;
+    pthread_once(&g_once, pick_impl);
+
+    size_t words = (nbits + 63) / 64, w = 0;
+    size_t n = g_impl->fn(prev, cur, &w, words, nbits, out, 0, max_out);
+    if (w < words && n < max_out)
+        n = scan_scalar(prev, cur, &w, words, nbits, out, n, max_out);
+    return n;
+}
@@ -0,0 +1,310 @@
+// SPDX-License-Identifier: MIT
+// Signal models: field-realistic raw edge streams for the simulated backend
+// Notes:
+// - Per line, a contact signal (human press timing, bounce, slow ramps) is
+//   combined with disturbances: a short forces the active level, an EMI spike
+//   inverts whatever the contact reads. Edges are the changes of the result,
+//   so overlapping effects stay consistent
+// - EMI bursts are shared by all lines (one harness), with per-line jitter;
+//   everything else is independent per line
+// - Deterministic for a given seed; no global state
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "btns_signal.h"
+
+#define SIG_SEED_DEFAULT 0x9e3779b97f4a7c15ull
+
+enum { EV_CONTACT, EV_SHORT_ON, EV_SHORT_OFF, EV_EMI_ON, EV_EMI_OFF };
+
+struct sig_ev {
+    uint64_t t_us;
+    uint32_t seq;      // insertion order: ties resolve as generated
+    uint8_t  what;
+    uint8_t  level;    // EV_CONTACT
+    uint8_t  kind;     // btns_sig_kind_t of the resulting edge
+};
+
+struct sig_buf {
+    struct sig_ev *ev;
+    size_t n, cap;
+};
+
+struct sig_rng {
+    uint64_t s;
+};
+
+static uint64_t rnd(struct sig_rng *r)
+{
+    r->s ^= r->s << 13;
+    r->s ^= r->s >> 7;
+    r->s ^= r->s << 17;
+    return r->s;
+}
+
+static double unif(struct sig_rng *r)   // [0, 1)
+{
+    return (double)(rnd(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double lognormal(struct sig_rng *r, double median, double sigma)
+{
+    double u = 1.0 - unif(r), v = unif(r);
+    return median * exp(sigma * sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v));
+}
+
+static double expo(struct sig_rng *r, double rate)   // Poisson interarrival
+{
+    return -log(1.0 - unif(r)) / rate;
+}
+
+static int push(struct sig_buf *b, uint64_t t, int what, int level, btns_sig_kind_t kind)
+{
+    if (b->n == b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 256;
+        struct sig_ev *ev = realloc(b->ev, cap * sizeof(*ev));
+        if (!ev) return -ENOMEM;
+        b->ev = ev;
+        b->cap = cap;
+    }
+    b->ev[b->n] = (struct sig_ev){ t, (uint32_t)b->n, (uint8_t)what, (uint8_t)level, (uint8_t)kind };
+    b->n++;
+    return 0;
+}
+
+static int ev_cmp(const void *a, const void *b)
+{
+    const struct sig_ev *x = a, *y = b;
+    if (x->t_us != y->t_us) return x->t_us < y->t_us ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+// One intended transition to `level` at t; returns when the contact settles.
+// Slow ramp: the input hovers at the threshold, the noise on it crosses it
+// back and forth for ramp_us. Bounce: the contact reopens while the
+// mechanical oscillation, decaying as exp(-t/tau), is above a per-transition
+// threshold; open/closed times shrink with it.
+static int transition(const btns_signal_model_t *m, struct sig_rng *r, struct sig_buf *b,
+                      uint64_t t, int level, btns_sig_kind_t kind, uint64_t *settled)
+{
+    int rc = push(b, t, EV_CONTACT, level, kind);
+    if (rc) return rc;
+
+    if (m->ramp_pct && rnd(r) % 100 < m->ramp_pct) {
+        unsigned crossings = 1 + (unsigned)(rnd(r) % 4);
+        double spacing = (double)m->ramp_us / (crossings + 1);
+        for (unsigned k = 0; k < crossings && !rc; k++) {
+            uint64_t at = t + (uint64_t)(spacing * (k + 1 + (unif(r) - 0.5) * 0.5));
+            uint64_t w  = 1 + (uint64_t)(spacing * unif(r) / 3);
+            rc = push(b, at, EV_CONTACT, !level, BTNS_SIG_RAMP);
+            if (!rc) rc = push(b, at + w, EV_CONTACT, level, BTNS_SIG_RAMP);
+        }
+        t += m->ramp_us;
+    }
+
+    if (m->bounce_tau_us) {
+        double tau = m->bounce_tau_us * (level ? 0.5 : 1.0);   // release bounces less
+        double thr = 0.15 + 0.30 * unif(r);
+        double e = 0;
+        for (unsigned k = 0; k < m->bounce_max && !rc; k++) {
+            double a = exp(-e / tau);
+            if (a < thr) break;
+            double closed = tau * 0.30 * a * (0.5 + unif(r));
+            double open   = tau * 0.40 * a * (0.5 + unif(r));
+            if (open < 1.0) break;
+            e += closed;
+            rc = push(b, t + (uint64_t)e, EV_CONTACT, !level, BTNS_SIG_BOUNCE);
+            e += open;
+            if (!rc) rc = push(b, t + (uint64_t)e, EV_CONTACT, level, BTNS_SIG_BOUNCE);
+        }
+        t += (uint64_t)e;
+    }
+    *settled = t;
+    return rc;
+}
+
+static int contact(const btns_signal_model_t *m, struct sig_rng *r, struct sig_buf *b, uint64_t end)
+{
+    uint64_t t = (uint64_t)(lognormal(r, m->gap_ms * 1000.0, m->gap_sigma) * unif(r));
+    int rc = 0;
+    while (t < end && !rc) {
+        uint64_t settled;
+        rc = transition(m, r, b, t, 0, BTNS_SIG_PRESS, &settled);
+        double hold = (m->long_pct && rnd(r) % 100 < m->long_pct)
+                          ? m->long_ms * 1000.0 * (1.0 + unif(r))
+                          : lognormal(r, m->press_ms * 1000.0, m->press_sigma);
+        uint64_t up = t + (uint64_t)hold;
+        if (up <= settled) up = settled + 1000;
+        if (!rc) rc = transition(m, r, b, up, 1, BTNS_SIG_RELEASE, &settled);
+        t = settled + (uint64_t)lognormal(r, m->gap_ms * 1000.0, m->gap_sigma) + 1000;
+    }
+    return rc;
+}
+
+static int shorts(const btns_signal_model_t *m, struct sig_rng *r, struct sig_buf *b, uint64_t end)
+{
+    int rc = 0;
+    if (m->short_hz <= 0) return 0;
+    for (double t = expo(r, m->short_hz) * 1e6; t < (double)end && !rc; t += expo(r, m->short_hz) * 1e6) {
+        uint64_t w = 1 + (uint64_t)(m->short_us * (0.5 + unif(r)));
+        rc = push(b, (uint64_t)t, EV_SHORT_ON, 0, BTNS_SIG_SHORT);
+        if (!rc) rc = push(b, (uint64_t)t + w, EV_SHORT_OFF, 0, BTNS_SIG_SHORT);
+        t += (double)w;
+    }
+    return rc;
+}
+
+// Shared burst times (bursts[i] in us); each line adds its own jitter
+static int emi(const btns_signal_model_t *m, struct sig_rng *r, struct sig_buf *b,
+               const uint64_t *bursts, size_t nbursts)
+{
+    int rc = 0;
+    for (size_t i = 0; i < nbursts && !rc; i++) {
+        uint64_t t = bursts[i] + rnd(r) % 6;
+        for (unsigned k = 0; k < m->emi_spikes && !rc; k++) {
+            uint64_t w = 1 + (uint64_t)(m->emi_width_us * (0.5 + unif(r)));
+            rc = push(b, t, EV_EMI_ON, 0, BTNS_SIG_EMI);
+            if (!rc) rc = push(b, t + w, EV_EMI_OFF, 0, BTNS_SIG_EMI);
+            t += w + 50 + rnd(r) % 100;
+        }
+    }
+    return rc;
+}
+
+// Combine the line's events into edges of the resulting level (idle high)
+static int sweep(struct sig_buf *b, unsigned line, btns_sig_edge_t **out, size_t *n, size_t *cap)
+{
+    qsort(b->ev, b->n, sizeof(*b->ev), ev_cmp);
+    int c = 1, level = 1;
+    unsigned shorted = 0, spikes = 0;
+    for (size_t i = 0; i < b->n;) {
+        uint64_t t = b->ev[i].t_us;
+        uint8_t kind = b->ev[i].kind;
+        bool by_contact = false;   // a contact change names the edge
+        for (; i < b->n && b->ev[i].t_us == t; i++) {
+            const struct sig_ev *e = &b->ev[i];
+            if (e->what == EV_CONTACT || !by_contact) kind = e->kind;
+            switch (e->what) {
+            case EV_CONTACT:   c = e->level; by_contact = true; break;
+            case EV_SHORT_ON:  shorted++; break;
+            case EV_SHORT_OFF: shorted--; break;
+            case EV_EMI_ON:    spikes++; break;
+            default:           spikes--; break;
+            }
+        }
+        int now = shorted ? 0 : spikes ? !c : c;
+        if (now == level) continue;
+        level = now;
+        if (*n == *cap) {
+            size_t nc = *cap ? *cap * 2 : 1024;
+            btns_sig_edge_t *o = realloc(*out, nc * sizeof(**out));
+            if (!o) return -ENOMEM;
+            *out = o;
+            *cap = nc;
+        }
+        (*out)[(*n)++] = (btns_sig_edge_t){ t, line, (uint8_t)level, kind };
+    }
+    return 0;
+}
+
+static int edge_cmp(const void *a, const void *b)
+{
+    const btns_sig_edge_t *x = a, *y = b;
+    if (x->t_us != y->t_us) return x->t_us < y->t_us ? -1 : 1;
+    return x->line < y->line ? -1 : x->line > y->line;
+}
+
+long btns_signal_generate(const btns_signal_model_t *model, unsigned lines, unsigned duration_ms,
+                          btns_sig_edge_t **out)
+{
+    if (!model || !out || lines == 0 || duration_ms == 0) return -EINVAL;
+    *out = NULL;
+
+    btns_signal_model_t m = *model;
+    if (!m.press_ms)    m.press_ms = 90;
+    if (m.press_sigma <= 0) m.press_sigma = 0.4;
+    if (!m.gap_ms)      m.gap_ms = 300;
+    if (m.gap_sigma <= 0) m.gap_sigma = 0.7;
+    if (!m.long_ms)     m.long_ms = 800;
+    if (!m.bounce_max)  m.bounce_max = 10;
+    if (!m.ramp_us)     m.ramp_us = 2000;
+    if (!m.emi_spikes)  m.emi_spikes = 3;
+    if (!m.emi_width_us) m.emi_width_us = 20;
+    if (!m.short_us)    m.short_us = 3000;
+
+    uint64_t end = (uint64_t)duration_ms * 1000u;
+    struct sig_rng r = { m.seed ? m.seed : SIG_SEED_DEFAULT };
+    uint64_t *bursts = NULL;
+    size_t nbursts = 0, cap = 0, n = 0;
+    int rc = 0;
+    if (m.emi_hz > 0) {
+        for (double t = expo(&r, m.emi_hz) * 1e6; t < (double)end && !rc; t += expo(&r, m.emi_hz) * 1e6) {
+            if (nbursts == cap) {
+                cap = cap ? cap * 2 : 64;
+                uint64_t *nb = realloc(bursts, cap * sizeof(*nb));
+                if (!nb) { rc = -ENOMEM; break; }
+                bursts = nb;
+            }
+            bursts[nbursts++] = (uint64_t)t;
+        }
+    }
+
+    struct sig_buf b = { NULL, 0, 0 };
+    cap = 0;
+    for (unsigned l = 0; l < lines && !rc; l++) {
+        struct sig_rng lr = { rnd(&r) | 1 };
+        b.n = 0;
+        rc = contact(&m, &lr, &b, end);
+        if (!rc) rc = shorts(&m, &lr, &b, end);
+        if (!rc) rc = emi(&m, &lr, &b, bursts, nbursts);
+        if (!rc) rc = sweep(&b, l, out, &n, &cap);
+    }
+    free(b.ev);
+    free(bursts);
+    if (rc) { free(*out); *out = NULL; return rc; }
+    qsort(*out, n, sizeof(**out), edge_cmp);
+    return (long)n;
+}
+
+static const struct {
+    const char *name;
+    btns_signal_model_t m;
+} PRESETS[] = {
+    { "clean",  { 0 } },
+    { "new",    { .bounce_tau_us = 400 } },
+    { "worn",   { .bounce_tau_us = 3000, .bounce_max = 24 } },
+    { "cable",  { .bounce_tau_us = 500, .ramp_pct = 50, .ramp_us = 3000 } },
+    { "emi",    { .bounce_tau_us = 800, .emi_hz = 2.0, .emi_spikes = 3, .emi_width_us = 20 } },
+    { "field",  { .bounce_tau_us = 1500, .ramp_pct = 10, .emi_hz = 0.5, .short_hz = 0.1,
+                  .short_us = 3000, .long_pct = 10 } },
+    { "harsh",  { .bounce_tau_us = 5000, .bounce_max = 30, .ramp_pct = 30, .ramp_us = 4000,
+                  .emi_hz = 5.0, .emi_spikes = 6, .emi_width_us = 40, .short_hz = 1.0,
+                  .short_us = 8000, .long_pct = 20 } },
+};
+
+int btns_signal_preset(const char *name, btns_signal_model_t *m)
+{
+    if (!name || !m) return -EINVAL;
+    for (size_t i = 0; i < sizeof(PRESETS) / sizeof(PRESETS[0]); i++) {
+        if (strcmp(name, PRESETS[i].name)) continue;
+        *m = PRESETS[i].m;
+        return 0;
+    }
+    return -EINVAL;
+}
+
+const char *btns_signal_presets(void)
+{
+    return "clean new worn cable emi field harsh";
+}
+
+static const char *const KIND_NAMES[] = { "press", "release", "bounce", "ramp", "emi", "short", "raw" };
+
+const char *btns_sig_kind_name(btns_sig_kind_t k)
+{
+    return (unsigned)k < sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0]) ? KIND_NAMES[k] : "?";
+}
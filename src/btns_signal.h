@@ -0,0 +1,67 @@
+#ifndef BTNS_SIGNAL_H
+#define BTNS_SIGNAL_H
+
+#include <stdint.h>
+
+// Signal models (btns_signal.c): field-realistic raw edge streams for the
+// simulated backend, benchmarks and fuzzing: human press timing plus contact
+// bounce, slow ramps, EMI bursts and intermittent shorts, reproducible from a
+// seed. Levels are raw levels of an active-low line with pull-up (1 =
+// released, every line starts released).
+// Built as the static helper btns_sim for btns-bench and keypad-hid's load
+// generator; not part of the installed libbuttons.
+
+typedef enum {
+    BTNS_SIG_PRESS = 0,    // first edge of an intended press
+    BTNS_SIG_RELEASE,      // first edge of an intended release
+    BTNS_SIG_BOUNCE,       // contact bounce after a transition
+    BTNS_SIG_RAMP,         // slow edge: noise crossing the threshold
+    BTNS_SIG_EMI,          // induced spike (bursts hit all lines)
+    BTNS_SIG_SHORT,        // intermittent short to the active level
+    BTNS_SIG_RAW           // recorded edge, cause unknown
+} btns_sig_kind_t;
+const char *btns_sig_kind_name(btns_sig_kind_t k);
+
+typedef struct {
+    uint64_t t_us;         // from the start of the stream
+    unsigned line;
+    uint8_t  level;
+    uint8_t  kind;         // btns_sig_kind_t
+} btns_sig_edge_t;
+
+// 0 = default for the timing fields; a disturbance with 0 rate/time is off
+typedef struct {
+    // Human timing: log-normal hold and gap (median ms, sigma of the log);
+    // long_pct % of the presses are held long_ms..2*long_ms instead
+    unsigned press_ms;         // 90
+    double   press_sigma;      // 0.4
+    unsigned gap_ms;           // 300
+    double   gap_sigma;        // 0.7
+    unsigned long_pct;
+    unsigned long_ms;          // 800
+    // Contact bounce: the contact reopens while an oscillation decaying as
+    // exp(-t/tau) is above a random threshold; releases bounce half as long
+    unsigned bounce_tau_us;
+    unsigned bounce_max;       // reopenings per transition, 10
+    // Slow ramps: ramp_pct % of the transitions chatter for ramp_us first
+    unsigned ramp_pct;
+    unsigned ramp_us;          // 2000
+    // EMI: bursts/s (Poisson) of emi_spikes inverted spikes of ~emi_width_us
+    double   emi_hz;
+    unsigned emi_spikes;       // 3
+    unsigned emi_width_us;     // 20
+    // Shorts: per line, shorts/s (Poisson) of ~short_us at the active level
+    double   short_hz;
+    unsigned short_us;         // 3000
+    uint64_t seed;             // 0 = fixed default
+} btns_signal_model_t;
+
+// "clean" "new" "worn" "cable" "emi" "field" "harsh"; -EINVAL if unknown
+int         btns_signal_preset(const char *name, btns_signal_model_t *m);
+const char *btns_signal_presets(void);   // the names, space separated
+// Edges of lines 0..lines-1 over about duration_ms, sorted by time (then
+// line); *out is malloc'd. Returns the count or a negative errno.
+long        btns_signal_generate(const btns_signal_model_t *m, unsigned lines, unsigned duration_ms,
+                                 btns_sig_edge_t **out);
+
+#endif
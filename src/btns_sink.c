@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: MIT
+// Pipeline sinks: uinput keyboard, UHID NKRO keyboard, /dev/null, callback
+// Notes:
+// - A frame is one write(): uinput gets the key events + a single SYN_REPORT,
+//   uhid one NKRO report with every key changed in the batch
+// - The UHID device is a real HID keyboard: modifier byte + one bit per usage
+//   0..HID_NKRO_USAGES-1, so any number of keys can be down (no 6KRO report)
+// - btns_sink_open(UHID) returns once the kernel sent UHID_START (or fails
+//   with -ETIMEDOUT after UHID_START_TIMEOUT_MS)
+// - null sinks keep the encoding and write() path but target /dev/null
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <linux/uhid.h>
+#include "buttons.h"
+
+#define HID_NKRO_USAGES     160
+#define HID_NKRO_REPORT_LEN (1 + HID_NKRO_USAGES / 8)
+#define UHID_START_TIMEOUT_MS 1000
+
+static const uint8_t HID_NKRO_RDESC[] = {
+    0x05, 0x01,         // Usage Page (Generic Desktop)
+    0x09, 0x06,         // Usage (Keyboard)
+    0xA1, 0x01,         // Collection (Application)
+    0x05, 0x07,         //   Usage Page (Keyboard/Keypad)
+    0x19, 0xE0,         //   Usage Minimum (Left Control)
+    0x29, 0xE7,         //   Usage Maximum (Right GUI)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x25, 0x01,         //   Logical Maximum (1)
+    0x75, 0x01,         //   Report Size (1)
+    0x95, 0x08,         //   Report Count (8)
+    0x81, 0x02,         //   Input (Data,Var,Abs)      modifiers
+    0x19, 0x00,         //   Usage Minimum (0)
+    0x29, HID_NKRO_USAGES - 1, // Usage Maximum
+    0x95, HID_NKRO_USAGES,     // Report Count
+    0x81, 0x02,         //   Input (Data,Var,Abs)      key bitmap
+    0xC0,               // End Collection
+};
+
+struct dev_sink {
+    btns_sink_t      base;   // first: btns_sink_t * <-> struct dev_sink *
+    btns_sink_kind_t kind;
+    int              wfd;    // device or /dev/null
+    bool             device; // virtual device created (destroy on close)
+
+    // uinput: pending frame (+1 for SYN_REPORT)
+    struct input_event ev[BUTTONS_MAX_LINES + 1];
+    size_t             nev;
+
+    // uhid: current report
+    uint8_t report[HID_NKRO_REPORT_LEN];
+    bool    dirty;
+};
+
+// ---------- uinput ----------
+static int uinput_setup_keyboard(int fd, const btns_keymap_t *map, size_t n)
+{
+    if (ioctl(fd, UI_SET_EVBIT, EV_KEY) < 0) return -errno;
+    if (ioctl(fd, UI_SET_EVBIT, EV_SYN) < 0) return -errno;
+
+    for (size_t i = 0; i < n; i++) {
+        if (map[i].keycode > 0)
+            if (ioctl(fd, UI_SET_KEYBIT, map[i].keycode) < 0) return -errno;
+    }
+
+    struct uinput_setup us;
+    memset(&us, 0, sizeof(us));
+    us.id.bustype = BUS_USB;
+    us.id.vendor  = 0x0001;
+    us.id.product = 0x0001;
+    us.id.version = 0x0001;
+    snprintf(us.name, sizeof(us.name), "Keypad HID (buttons-sdk)");
+
+    if (ioctl(fd, UI_DEV_SETUP, &us) < 0) return -errno;
+    if (ioctl(fd, UI_DEV_CREATE) < 0) return -errno;
+    return 0;
+}
+
+static int uinput_key(btns_sink_t *s, const btns_keymap_t *k, bool down)
+{
+    struct dev_sink *d = (struct dev_sink *)s;
+    if (d->nev == BUTTONS_MAX_LINES) {
+        int rc = s->flush(s);
+        if (rc) return rc;
+    }
+    struct input_event *ev = &d->ev[d->nev++];
+    memset(ev, 0, sizeof(*ev));
+    ev->type  = EV_KEY;
+    ev->code  = (uint16_t)k->keycode;
+    ev->value = down ? 1 : 0;
+    return 0;
+}
+
+// Key events + SYN_REPORT in a single write(): one input frame
+static int uinput_flush(btns_sink_t *s)
+{
+    struct dev_sink *d = (struct dev_sink *)s;
+    if (!d->nev) return 0;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);   // input_event expects timeval
+    struct input_event *syn = &d->ev[d->nev];
+    memset(syn, 0, sizeof(*syn));
+    syn->type = EV_SYN;
+    syn->code = SYN_REPORT;
+    for (size_t i = 0; i <= d->nev; i++) d->ev[i].time = tv;
+    size_t len = (d->nev + 1) * sizeof(d->ev[0]);
+    d->nev = 0;
+    return write(d->wfd, d->ev, len) == (ssize_t)len ? 0 : -EIO;
+}
+
+// ---------- UHID ----------
+static void hid_nkro_bit(int usage, size_t *byte, uint8_t *mask)
+{
+    if (usage >= 0xE0) { *byte = 0; *mask = (uint8_t)(1u << (usage - 0xE0)); return; }
+    *byte = 1 + (size_t)usage / 8;
+    *mask = (uint8_t)(1u << (usage % 8));
+}
+
+// HID core drops input reports until it has parsed the descriptor and sent
+// UHID_START; wait for it so the first frame is not lost. Closing the fd
+// on failure destroys the half-created device.
+static int uhid_wait_start(int fd)
+{
+    struct timespec now, end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    end.tv_sec += UHID_START_TIMEOUT_MS / 1000;
+    end.tv_nsec += (long)(UHID_START_TIMEOUT_MS % 1000) * 1000000L;
+    if (end.tv_nsec >= 1000000000L) { end.tv_sec++; end.tv_nsec -= 1000000000L; }
+
+    for (;;) {
+        struct uhid_event ev;
+        ssize_t n = read(fd, &ev, sizeof(ev));
+        if (n > 0 && ev.type == UHID_START) return 0;
+        if (n < 0 && errno != EAGAIN && errno != EINTR) return -errno;
+        if (n > 0) continue;   // OPEN/CLOSE etc. before START: not ours to answer yet
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long left = (long)(end.tv_sec - now.tv_sec) * 1000 + (end.tv_nsec - now.tv_nsec) / 1000000L;
+        if (left <= 0) return -ETIMEDOUT;
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, (int)left) < 0 && errno != EINTR) return -errno;
+    }
+}
+
+static int uhid_create(int fd)
+{
+    struct uhid_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_CREATE2;
+    snprintf((char *)ev.u.create2.name, sizeof(ev.u.create2.name), "Keypad HID NKRO (buttons-sdk)");
+    ev.u.create2.rd_size = sizeof(HID_NKRO_RDESC);
+    ev.u.create2.bus     = BUS_USB;
+    ev.u.create2.vendor  = 0x0001;
+    ev.u.create2.product = 0x0002;
+    ev.u.create2.version = 0x0001;
+    memcpy(ev.u.create2.rd_data, HID_NKRO_RDESC, sizeof(HID_NKRO_RDESC));
+    if (write(fd, &ev, sizeof(ev)) != (ssize_t)sizeof(ev)) return -errno ? -errno : -EIO;
+    return uhid_wait_start(fd);
+}
+
+static int uhid_key(btns_sink_t *s, const btns_keymap_t *k, bool down)
+{
+    struct dev_sink *d = (struct dev_sink *)s;
+    if (k->hid_usage < 0 || k->hid_usage >= 0xE8 ||
+        (k->hid_usage < 0xE0 && k->hid_usage >= HID_NKRO_USAGES)) return -EINVAL;
+    size_t b; uint8_t m;
+    hid_nkro_bit(k->hid_usage, &b, &m);
+    if (down) d->report[b] |= m; else d->report[b] &= (uint8_t)~m;
+    d->dirty = true;
+    return 0;
+}
+
+// One write for the whole report (header + payload only)
+static int uhid_flush(btns_sink_t *s)
+{
+    struct dev_sink *d = (struct dev_sink *)s;
+    if (!d->dirty) return 0;
+    struct uhid_event ev;
+    ev.type = UHID_INPUT2;
+    ev.u.input2.size = HID_NKRO_REPORT_LEN;
+    memcpy(ev.u.input2.data, d->report, HID_NKRO_REPORT_LEN);
+    size_t len = offsetof(struct uhid_event, u.input2.data) + HID_NKRO_REPORT_LEN;
+    d->dirty = false;
+    return write(d->wfd, &ev, len) == (ssize_t)len ? 0 : -EIO;
+}
+
+// Kernel -> device messages: reject report requests so HID core does not
+// wait for its timeout, ignore START/OPEN/CLOSE/OUTPUT.
+static void uhid_service(btns_sink_t *s)
+{
+    struct uhid_event ev;
+    while (read(s->fd, &ev, sizeof(ev)) > 0) {
+        struct uhid_event r;
+        memset(&r, 0, sizeof(r));
+        if (ev.type == UHID_GET_REPORT) {
+            r.type = UHID_GET_REPORT_REPLY;
+            r.u.get_report_reply.id  = ev.u.get_report.id;
+            r.u.get_report_reply.err = EIO;
+        } else if (ev.type == UHID_SET_REPORT) {
+            r.type = UHID_SET_REPORT_REPLY;
+            r.u.set_report_reply.id  = ev.u.set_report.id;
+            r.u.set_report_reply.err = EIO;
+        } else {
+            continue;
+        }
+        if (write(s->fd, &r, sizeof(r)) < 0) {}
+    }
+}
+
+// ---------- Device sinks ----------
+static void dev_destroy(btns_sink_t *s)
+{
+    struct dev_sink *d = (struct dev_sink *)s;
+    if (d->device) {
+        if (d->kind == BTNS_SINK_UHID) {
+            struct uhid_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.type = UHID_DESTROY;
+            if (write(d->wfd, &ev, sizeof(ev)) < 0) {}
+        } else {
+            ioctl(d->wfd, UI_DEV_DESTROY);
+        }
+    }
+    close(d->wfd);
+    free(d);
+}
+
+static struct dev_sink *dev_alloc(btns_sink_kind_t kind, int fd)
+{
+    struct dev_sink *d = calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->kind = kind;
+    d->wfd = fd;
+    d->base.fd = -1;
+    d->base.destroy = dev_destroy;
+    if (kind == BTNS_SINK_UHID) {
+        d->base.key = uhid_key;
+        d->base.flush = uhid_flush;
+        d->base.hid = true;
+    } else {
+        d->base.key = uinput_key;
+        d->base.flush = uinput_flush;
+    }
+    return d;
+}
+
+int btns_sink_open(btns_sink_t **out, btns_sink_kind_t kind, const btns_keymap_t *map, size_t count)
+{
+    if (!out || (kind == BTNS_SINK_UINPUT && (!map || !count))) return -EINVAL;
+    int fd = kind == BTNS_SINK_UHID ? open("/dev/uhid", O_RDWR | O_CLOEXEC | O_NONBLOCK)
+                                    : open("/dev/uinput", O_WRONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0) return -errno ? -errno : -ENODEV;
+
+    int rc = kind == BTNS_SINK_UHID ? uhid_create(fd) : uinput_setup_keyboard(fd, map, count);
+    struct dev_sink *d = rc ? NULL : dev_alloc(kind, fd);
+    if (!d) {
+        close(fd);
+        return rc ? rc : -ENOMEM;
+    }
+    d->device = true;
+    if (kind == BTNS_SINK_UHID) {   // uinput is write-only: nothing to poll
+        d->base.fd = fd;
+        d->base.service = uhid_service;
+    }
+    *out = &d->base;
+    return 0;
+}
+
+int btns_sink_null_open(btns_sink_t **out, btns_sink_kind_t kind)
+{
+    if (!out) return -EINVAL;
+    int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -errno;
+    struct dev_sink *d = dev_alloc(kind, fd);
+    if (!d) { close(fd); return -ENOMEM; }
+    *out = &d->base;
+    return 0;
+}
+
+// ---------- Callback sink ----------
+struct cb_sink {
+    btns_sink_t base;
+    int  (*on_key)(void *user, int keycode, bool down);
+    int  (*on_flush)(void *user);
+    void *user;
+};
+
+static int cb_key(btns_sink_t *s, const btns_keymap_t *k, bool down)
+{
+    struct cb_sink *c = (struct cb_sink *)s;
+    return c->on_key(c->user, k->keycode, down);
+}
+
+static int cb_flush(btns_sink_t *s)
+{
+    struct cb_sink *c = (struct cb_sink *)s;
+    return c->on_flush ? c->on_flush(c->user) : 0;
+}
+
+static void cb_destroy(btns_sink_t *s)
+{
+    free(s);
+}
+
+int btns_sink_callback_open(btns_sink_t **out, int (*on_key)(void *user, int keycode, bool down),
+                            int (*on_flush)(void *user), void *user)
+{
+    if (!out || !on_key) return -EINVAL;
+    struct cb_sink *c = calloc(1, sizeof(*c));
+    if (!c) return -ENOMEM;
+    c->base.key = cb_key;
+    c->base.flush = cb_flush;
+    c->base.destroy = cb_destroy;
+    c->base.fd = -1;
+    c->on_key = on_key;
+    c->on_flush = on_flush;
+    c->user = user;
+    *out = &c->base;
+    return 0;
+}
@@ -1,10 +1,60 @@
 #include "buttons.h"
 #include "gpio_backend.h"
 #include <pthread.h>
+#include <semaphore.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/eventfd.h>
 #include "version.h"
+
+// BOOTTIME - MONOTONIC only grows while the system is suspended; a jump
+// larger than this between two checks means we just resumed.
+#define BTNS_SUSPEND_GAP_MS 50
+
+#define BTNS_PAIR_WINDOW_DEFAULT_MS 20
+#define BTNS_NOISE_EDGES_DEFAULT    4
+#define BTNS_NOISE_WINDOW_DEFAULT_MS 50
+#define BTNS_LEVEL_NOISE            2   // gpio_alert_cb level (backend noise filter)
+
+// Worker sleep cap with no timer pending (resume check without edges)
+#define BTNS_IDLE_SLEEP_MS 1000
+
+// Subscriptions: dispatch rows = (BTN_EVENT_OVERRUN+1) event types x buttons
+#define BTNS_SUB_EVENTS (BTN_EVENT_OVERRUN+1)
+
+// BTN_EVENT_OVERRUN rate limit, per callback
+#define BTNS_OVERRUN_REPORT_MS 1000
+
+// Per-priority event queue (only used when some pin is BTN_PRIO_CRITICAL)
+#define BTNS_QUEUE_LEN 256   // power of two
+
+typedef struct {
+    unsigned    seq;    // ring cell sequence (bounded MPMC ring)
+    btn_event_t evt;
+    unsigned    idx;
+    unsigned    gpio;
+    uint64_t    t_ns;   // generated (MONOTONIC)
+} btn_qev_t;
+
+// Lock-free: producers (alert callbacks, worker) reserve cells with a CAS on
+// tail, the single dispatcher consumes from head. No producer ever blocks the
+// dispatcher, which is what keeps the critical lane bounded under a flood.
+typedef struct {
+    btn_qev_t ev[BTNS_QUEUE_LEN];
+    unsigned  tail;     // producers
+    unsigned  head;     // dispatcher only
+    btns_lane_stats_t stats;   // dropped: producers (atomic), rest: dispatcher
+} btn_lane_t;
+
 typedef struct {
     unsigned gpio;
     int  pull;            // 0/1/2
@@ -14,90 +64,1320 @@ typedef struct {
     uint32_t down_ms;
     bool hold_fired;
     uint32_t last_repeat_ms;
+    bool wakeup;          // btn_pin_t.wakeup
+    bool silent;          // adopted as pressed on resume: no HOLD/REPEAT/RELEASE/CLICK
+    uint8_t prio;         // btn_prio_t
+    unsigned shard;       // owner (cfg.shards), 0 otherwise
+    unsigned slot;        // line index in the shard's gpios[]/levels[]
+
+    // Dual-channel (paired) inputs
+    bool paired;
+    bool pair_inverted;
+    unsigned pair_gpio;
+    unsigned pair_slot;       // index of pair_gpio in the shard's gpios[]/levels[]
+    bool ch[2];               // logical level per channel
+    uint32_t ch_tick[2];      // backend tick (us) of each channel's last change
+    uint32_t ch_edge_ms[2];   // per-channel software debounce
+    uint32_t disagree_ms;     // channels disagree since (0 = agree)
+    bool fault;               // latched until both channels report released
+
+    // Noise filter (btn_pin_t.noise_filter)
+    bool nf;
+    bool noisy;               // burst classified, NOISE already reported
+    bool nz_pending;          // edges seen, waiting for quiet + level confirm
+    unsigned nz_count;        // edges in the current window
+    uint32_t nz_start_ms;
+    uint32_t nz_last_ms;
+
+    // Autofire (btn_pin_t.turbo_ms)
+    uint32_t turbo_ms;        // period, 0 = off: down turbo_ms/2, up the rest
+    uint32_t turbo_next;      // next toggle (down_ms + whole periods + phase)
+    bool turbo_up;            // synthetic RELEASE in effect
 } btn_state_t;
 
+// Execution time of one callback (cfg.cb_budget_us). Updated with relaxed
+// atomics: a consumer may be called from the dispatcher and the framer.
+// Never freed before destroy, so a table being walked can still point here.
+typedef struct btn_cbstat {
+    unsigned           id;
+    btns_cb_stats_t    s;
+    uint32_t           report_ms;   // last OVERRUN (atomic, CAS claims a report)
+    bool               reported;    // atomic
+    bool               overrun;     // OVERRUN owed, sent once the call returned
+    struct btn_cbstat *next;        // all of them, for lookup and destroy
+} btn_cbstat_t;
+
+// btns_subscribe() registration (source of the compiled table)
+typedef struct {
+    int           id;
+    uint32_t      events;
+    uint64_t     *buttons;     // NULL = all
+    btns_event_fn fn;
+    void         *user;
+    btn_cbstat_t *stats;       // NULL = timing off
+} btn_sub_reg_t;
+
+typedef struct { btns_event_fn fn; void *user; btn_cbstat_t *stats; } btn_sub_t;
+
+// Compiled subscriptions: the callbacks of row r are ent[off[r]..off[r+1]).
+// Immutable once published; replaced tables stay allocated until destroy,
+// since a dispatching thread may still walk one.
+typedef struct btn_subtab {
+    struct btn_subtab *retired;   // previous table
+    uint32_t          *off;       // rows + 1
+    btn_sub_t         *ent;
+} btn_subtab_t;
+
+// Sharded edge processing (cfg.shards): backend edges, or logical states from
+// btns_feed_changes() (idx >= 0), queued to the shard owning the line.
+#define BTNS_SHARD_RING 1024   // power of two
+
+typedef struct {
+    unsigned seq;
+    unsigned gpio;
+    int      idx;
+    int      level;
+    uint32_t tick;
+    uint32_t t_ms;      // arrival: debounce/timing do not see the queueing delay
+} btn_qedge_t;
+
+// Same bounded ring as btn_lane_t; ev[] keeps the producer and consumer
+// indices on different cache lines.
+typedef struct {
+    unsigned    tail;   // producers
+    btn_qedge_t ev[BTNS_SHARD_RING];
+    unsigned    head;   // shard thread only
+} btn_edge_ring_t;
+
+// Consumer thread sleep/wake. Producers only take the mutex when the
+// consumer announced it is going to sleep, so a busy consumer costs them one
+// fence and one load per item.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;      // CLOCK_MONOTONIC
+    bool            kick;
+    int             sleeping;
+} btn_waker_t;
+
+// A shard owns a set of buttons: their state, timers and level reads are only
+// ever written by its thread. Without cfg.shards there is a single shard,
+// served by the alert path and the worker.
+typedef struct btn_shard {
+    struct btns_ctx   *ctx;
+    unsigned          *idx;       // owned buttons, ascending
+    unsigned           n;
+    unsigned          *gpios;     // idx[] lines, then pair lines (gpio_read_levels)
+    int               *levels;
+    unsigned           nlines;
+    btns_timer_stats_t tstats;    // timers fired here; wakeups of the shard thread
+
+    // Shard thread (cfg.shards > 1)
+    pthread_t          thread;
+    btn_edge_ring_t   *in;
+    btn_lane_t        *out;       // -> merge; stats.dropped = times it was full
+    btn_waker_t        wake;
+    int                resync;    // resume seen: re-read own lines
+    btns_shard_stats_t stats;     // in_full: producers (atomic), rest: shard thread
+} __attribute__((aligned(64))) btn_shard_t;
+
 struct btns_ctx {
     btns_config_t cfg;
     btn_state_t  *st;
     pthread_t     worker;
     volatile int  running;
+    void         *stack_map;   // explicit worker stack incl. guard page (stack_kb != 0)
+    size_t        stack_map_sz;
+    btn_shard_t  *sh;          // button ownership; one shard without cfg.shards
+    unsigned      nsh;
+    bool          sharded;     // shard threads + merge stage
+    bool          nfilter;     // some pin uses the noise filter
+    int           debounce;    // btns_debounce_t, switched by btns_set_debounce
+    uint32_t      susp_ms;     // last seen BOOTTIME - MONOTONIC
+
+    btn_lane_t     *lanes;     // [BTN_PRIO_COUNT], NULL = inline dispatch
+    sem_t           qsem;      // one token per queued event
+    pthread_t       dispatcher;
+
+    int             fd;        // no_threads: backend event fd (-1 = inline alerts)
+    unsigned long   emitted;   // no_threads: events delivered (btns_process result)
+
+    // Deadline-driven worker: sleeps until the next (coalesced) timer, the
+    // edge path kicks it when a new deadline appears.
+    pthread_mutex_t wlock;
+    pthread_cond_t  wcond;     // CLOCK_MONOTONIC
+    bool            wkick;
+    uint32_t        start_ms;
+    btns_timer_stats_t tstats; // wakeups: worker / btns_process thread only
+
+    // Inactivity (cfg.idle_ms): level = thresholds already reported
+    unsigned       *idle_ms;
+    uint32_t        last_act_ms;
+    unsigned        idle_level;
+
+    // Frame-aligned delivery (cfg.frame_sync): normal-priority events wait
+    // here for the next frame_fd tick or the hold-back bound.
+    btn_lane_t     *frame;
+    unsigned        frame_pending;   // pushed - delivered
+    int             frame_wake;      // eventfd: buffer became non-empty / shutdown
+    bool            frame_broken;    // frame_fd error: hold-back only
+    pthread_t       framer;
+    btns_frame_stats_t fstats;       // consumer only (dropped: producers)
+
+    // Subscriptions (btns_subscribe): registry under sublock, compiled table
+    // read lock-free by every delivering thread
+    pthread_mutex_t sublock;
+    btn_sub_reg_t  *subreg;
+    unsigned        nsubreg;
+    int             sub_next_id;
+    btn_subtab_t   *subs;            // NULL = no subscribers
+
+    // Callback budget (cfg.cb_budget_us)
+    uint64_t        budget_ns;       // 0 = calls are not timed
+    btn_cbstat_t    cb_main;         // cfg.on_event
+    btn_cbstat_t   *cbstats;         // cb_main + one per subscription (sublock)
+    int             ovr_pending;     // some cbstat has overrun set
+
+    // Merge stage (sharded): shard event rings -> one delivering thread
+    pthread_t       merger;
+    btn_waker_t     mwake;
+    int             shard_stop;      // alerts removed: shards drain and exit
+    int             merge_stop;      // shards joined: merger drains and exits
 };
 
-static int find_index(struct btns_ctx *ctx, unsigned gpio){
-    for (unsigned i=0;i<ctx->cfg.count;i++)
-        if (ctx->st[i].gpio == gpio) return (int)i;
-    return -1;
+static uint32_t clock_ms(clockid_t id){
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec*1000u + (uint64_t)ts.tv_nsec/1000000u);
 }
 
-static void global_alert(int gpio, int level, uint32_t tick, void *userdata){
-    (void)tick;
-    struct btns_ctx *ctx = (struct btns_ctx*)userdata;
-    if (!ctx) return;
-    int idx = find_index(ctx, (unsigned)gpio);
-    if (idx<0) return;
+// HOLD/REPEAT timing: MONOTONIC does not advance during suspend, so a
+// suspend is never counted as press duration.
+static uint32_t now_ms(void){ return clock_ms(CLOCK_MONOTONIC); }
+
+static uint32_t suspended_ms(void){
+    return clock_ms(CLOCK_BOOTTIME) - clock_ms(CLOCK_MONOTONIC);
+}
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// A new deadline may be earlier than the one the worker sleeps towards
+static void kick_worker(struct btns_ctx *ctx){
+    if (ctx->cfg.no_threads) return;
+    pthread_mutex_lock(&ctx->wlock);
+    ctx->wkick = true;
+    pthread_cond_signal(&ctx->wcond);
+    pthread_mutex_unlock(&ctx->wlock);
+}
 
+// A button deadline appeared. Shard threads recompute theirs after every
+// batch, so only the worker needs telling.
+static void kick_timers(struct btns_ctx *ctx){
+    if (!ctx->sharded) kick_worker(ctx);
+}
+
+static void waker_init(btn_waker_t *w){
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&w->cond, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_mutex_init(&w->lock, NULL);
+    w->kick = false;
+    w->sleeping = 0;
+}
+
+static void waker_destroy(btn_waker_t *w){
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+}
+
+static void waker_kick(btn_waker_t *w){
+    pthread_mutex_lock(&w->lock);
+    w->kick = true;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Producer, after publishing. The fence pairs with the one in waker_arm():
+// either the consumer sees the item or we see it sleeping.
+static void waker_wake(btn_waker_t *w){
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->sleeping, __ATOMIC_RELAXED)) waker_kick(w);
+}
+
+// Consumer: arm, re-check for work, then waker_wait() or waker_disarm()
+static void waker_arm(btn_waker_t *w){
+    __atomic_store_n(&w->sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static void waker_disarm(btn_waker_t *w){
+    __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+// until: absolute CLOCK_MONOTONIC, NULL = until kicked
+static void waker_wait(btn_waker_t *w, const struct timespec *until){
+    pthread_mutex_lock(&w->lock);
+    while (!w->kick){
+        if (!until) pthread_cond_wait(&w->cond, &w->lock);
+        else if (pthread_cond_timedwait(&w->cond, &w->lock, until)==ETIMEDOUT) break;
+    }
+    w->kick = false;
+    pthread_mutex_unlock(&w->lock);
+    waker_disarm(w);
+}
+
+// Reserve + publish one cell; false = ring full (counted as dropped)
+static bool lane_push(btn_lane_t *l, btn_event_t evt, unsigned idx, unsigned gpio){
+    unsigned pos = __atomic_load_n(&l->tail, __ATOMIC_RELAXED);
+    btn_qev_t *q;
+    for (;;){
+        q = &l->ev[pos & (BTNS_QUEUE_LEN-1)];
+        int dif = (int)(__atomic_load_n(&q->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif==0){
+            if (__atomic_compare_exchange_n(&l->tail, &pos, pos+1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (dif<0){
+            __atomic_fetch_add(&l->stats.dropped, 1, __ATOMIC_RELAXED);   // lane full
+            return false;
+        } else {
+            pos = __atomic_load_n(&l->tail, __ATOMIC_RELAXED);
+        }
+    }
+    q->evt = evt;
+    q->idx = idx;
+    q->gpio = gpio;
+    q->t_ns = mono_ns();
+    __atomic_store_n(&q->seq, pos+1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void frame_push(struct btns_ctx *ctx, btn_event_t evt, unsigned idx, unsigned gpio){
+    if (!lane_push(ctx->frame, evt, idx, gpio)) return;
+    if (__atomic_fetch_add(&ctx->frame_pending, 1, __ATOMIC_ACQ_REL)==0 && ctx->frame_wake>=0){
+        uint64_t one = 1;
+        if (write(ctx->frame_wake, &one, sizeof(one)) < 0) {}   // counter; only needs to be non-zero
+    }
+}
+
+// IDLE carries a threshold number and OVERRUN a callback id, not a button:
+// one row per event type
+static bool per_button(unsigned evt){
+    return evt!=BTN_EVENT_IDLE && evt!=BTN_EVENT_OVERRUN;
+}
+
+static unsigned sub_row(struct btns_ctx *ctx, btn_event_t evt, unsigned idx){
+    return (unsigned)evt*ctx->cfg.count + (!per_button(evt) || idx>=ctx->cfg.count ? 0 : idx);
+}
+
+static void deliver(struct btns_ctx *ctx, btn_event_t evt, unsigned idx, unsigned gpio, unsigned prio);
+
+static void cb_account(struct btns_ctx *ctx, btn_cbstat_t *c, uint64_t ns){
+    btns_cb_stats_t *s = &c->s;
+    unsigned k = ns > 1 ? 63u - (unsigned)__builtin_clzll(ns) : 0;
+    if (k >= BTNS_CB_HIST_BUCKETS) k = BTNS_CB_HIST_BUCKETS-1;
+    __atomic_fetch_add(&s->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->sum_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->hist[k], 1, __ATOMIC_RELAXED);
+    if (ns > __atomic_load_n(&s->max_ns, __ATOMIC_RELAXED))
+        __atomic_store_n(&s->max_ns, ns, __ATOMIC_RELAXED);
+    if (ns <= ctx->budget_ns) return;
+    __atomic_fetch_add(&s->over_budget, 1, __ATOMIC_RELAXED);
+    uint32_t t = now_ms();
+    uint32_t last = __atomic_load_n(&c->report_ms, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&c->reported, __ATOMIC_ACQUIRE) && t - last < BTNS_OVERRUN_REPORT_MS) return;
+    // The dispatcher and the framer may both be here for one callback
+    if (!__atomic_compare_exchange_n(&c->report_ms, &last, t, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return;
+    __atomic_store_n(&c->reported, true, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&s->overrun_events, 1, __ATOMIC_RELAXED);
+    // Not delivered from here: an inline consumer would be re-entered from
+    // inside its own slow call. invoke() sends it once the call returned.
+    __atomic_store_n(&c->overrun, true, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->ovr_pending, 1, __ATOMIC_RELEASE);
+}
+
+// Owed OVERRUNs, queued like any event (a slow OVERRUN handler is itself
+// rate limited)
+static void overrun_flush(struct btns_ctx *ctx){
+    if (!__atomic_exchange_n(&ctx->ovr_pending, 0, __ATOMIC_ACQ_REL)) return;
+    for (btn_cbstat_t *c = __atomic_load_n(&ctx->cbstats, __ATOMIC_ACQUIRE); c; c = c->next)
+        if (__atomic_exchange_n(&c->overrun, false, __ATOMIC_ACQ_REL))
+            deliver(ctx, BTN_EVENT_OVERRUN, c->id, BTNS_NO_GPIO, BTN_PRIO_NORMAL);
+}
+
+static void call_cb(struct btns_ctx *ctx, btns_event_fn fn, void *user, btn_cbstat_t *c,
+                    btn_event_t evt, unsigned idx, unsigned gpio){
+    if (!ctx->budget_ns){ fn(user, evt, idx, gpio); return; }
+    uint64_t t0 = mono_ns();
+    fn(user, evt, idx, gpio);
+    cb_account(ctx, c, mono_ns() - t0);
+}
+
+// on_event + the subscribers compiled for (evt, idx); no per-subscriber test.
+// OVERRUNs owed by these calls go out afterwards (not after an OVERRUN: an
+// inline one would nest, it waits for the next event).
+static void invoke(struct btns_ctx *ctx, btn_event_t evt, unsigned idx, unsigned gpio){
+    if (ctx->cfg.on_event) call_cb(ctx, ctx->cfg.on_event, ctx->cfg.user, &ctx->cb_main, evt, idx, gpio);
+    const btn_subtab_t *t = __atomic_load_n(&ctx->subs, __ATOMIC_ACQUIRE);
+    if (t){
+        unsigned r = sub_row(ctx, evt, idx);
+        for (const btn_sub_t *s = t->ent + t->off[r], *e = t->ent + t->off[r+1]; s<e; s++)
+            call_cb(ctx, s->fn, s->user, s->stats, evt, idx, gpio);
+    }
+    if (evt!=BTN_EVENT_OVERRUN && __atomic_load_n(&ctx->ovr_pending, __ATOMIC_ACQUIRE)) overrun_flush(ctx);
+}
+
+// Nobody consumes (evt, idx): not queued at all
+static bool wanted(struct btns_ctx *ctx, btn_event_t evt, unsigned idx){
+    if (ctx->cfg.on_event) return true;
+    const btn_subtab_t *t = __atomic_load_n(&ctx->subs, __ATOMIC_ACQUIRE);
+    if (!t) return false;
+    unsigned r = sub_row(ctx, evt, idx);
+    return t->off[r+1] != t->off[r];
+}
+
+// Sharded: the owning shard thread queues for the merge stage. A full ring
+// is waited out, not dropped: a lost RELEASE would leave the button stuck.
+static void merge_push(struct btns_ctx *ctx, btn_event_t evt, unsigned idx, unsigned gpio){
+    btn_shard_t *sh = &ctx->sh[ctx->st[idx].shard];
+    while (!lane_push(sh->out, evt, idx, gpio)){
+        waker_wake(&ctx->mwake);
+        sched_yield();
+    }
+    __atomic_store_n(&sh->stats.events, sh->stats.events+1, __ATOMIC_RELAXED);
+    waker_wake(&ctx->mwake);
+}
+
+// Frame buffer, priority lane or inline (sharded: from the merge thread)
+static void route(struct btns_ctx *ctx, btn_event_t evt, unsigned idx, unsigned gpio, unsigned prio){
+    if (ctx->frame && prio==BTN_PRIO_NORMAL){
+        frame_push(ctx, evt, idx, gpio);
+        return;
+    }
+    if (!ctx->lanes){
+        if (ctx->cfg.no_threads) ctx->emitted++;
+        invoke(ctx, evt, idx, gpio);
+        return;
+    }
+    if (lane_push(&ctx->lanes[prio], evt, idx, gpio)) sem_post(&ctx->qsem);
+}
+
+static void deliver(struct btns_ctx *ctx, btn_event_t evt, unsigned idx, unsigned gpio, unsigned prio){
+    if (!wanted(ctx, evt, idx)) return;
+    if (ctx->sharded && per_button(evt) && idx<ctx->cfg.count){
+        merge_push(ctx, evt, idx, gpio);
+        return;
+    }
+    route(ctx, evt, idx, gpio, prio);
+}
+
+// Button event. Everything but NOISE/FAULT is user activity: restarts the
+// idle clock and, after an IDLE, is preceded by ACTIVITY. Sharded, the
+// merger sends IDLE, so it also decides ACTIVITY (merge_activity()); the
+// shard only queues a marker in case the event itself is not wanted.
+static void emit(struct btns_ctx *ctx, btn_event_t evt, unsigned idx){
     btn_state_t *b = &ctx->st[idx];
-    uint32_t t = gpio_now_ms();
+    if (ctx->cfg.idle_count && evt!=BTN_EVENT_NOISE && evt!=BTN_EVENT_FAULT){
+        __atomic_store_n(&ctx->last_act_ms, now_ms(), __ATOMIC_RELAXED);
+        if (ctx->sharded){
+            if (__atomic_load_n(&ctx->idle_level, __ATOMIC_ACQUIRE))
+                merge_push(ctx, BTN_EVENT_ACTIVITY, idx, b->gpio);
+        } else if (__atomic_exchange_n(&ctx->idle_level, 0, __ATOMIC_ACQ_REL)){
+            deliver(ctx, BTN_EVENT_ACTIVITY, idx, b->gpio, b->prio);
+            kick_worker(ctx);   // idle deadline moved forward
+        }
+    }
+    deliver(ctx, evt, idx, b->gpio, b->prio);
+}
 
-    // Yazılımsal debounce (glitch filter zaten var)
-    if ((t - b->last_edge_ms) < ctx->cfg.debounce_ms) return;
-    b->last_edge_ms = t;
+static bool lane_pop(btn_lane_t *l, btn_qev_t *out){
+    btn_qev_t *q = &l->ev[l->head & (BTNS_QUEUE_LEN-1)];
+    if (__atomic_load_n(&q->seq, __ATOMIC_ACQUIRE) != l->head+1) return false;
+    *out = *q;
+    __atomic_store_n(&q->seq, l->head+BTNS_QUEUE_LEN, __ATOMIC_RELEASE);
+    l->head++;
+    return true;
+}
 
-    bool logical_press = b->active_low ? (level==0) : (level==1);
+// Consumer side: oldest queued event, 0 = none visible (empty, or still
+// being published)
+static uint64_t lane_oldest_ns(btn_lane_t *l){
+    btn_qev_t *q = &l->ev[l->head & (BTNS_QUEUE_LEN-1)];
+    if (__atomic_load_n(&q->seq, __ATOMIC_ACQUIRE) != l->head+1) return 0;
+    return q->t_ns;
+}
+
+// ---------- Frame-aligned delivery ----------
+
+// ms until the hold-back bound forces a batch; -1 = nothing to force
+static int frame_timeout(struct btns_ctx *ctx){
+    if (!__atomic_load_n(&ctx->frame_pending, __ATOMIC_ACQUIRE)) return -1;
+    uint64_t t0 = lane_oldest_ns(ctx->frame);
+    if (!t0) return 1;                                  // producer mid-publish
+    uint64_t bound = ctx->frame_broken ? 0 : (uint64_t)ctx->cfg.frame_holdback_ms * 1000000ull;
+    if (!bound && !ctx->frame_broken) return -1;        // frames only
+    uint64_t age = mono_ns() - t0;
+    if (age >= bound) return 0;
+    return (int)((bound - age + 999999ull) / 1000000ull);
+}
+
+// Deliver everything buffered, in order, as one batch
+static unsigned frame_flush(struct btns_ctx *ctx, bool tick){
+    btn_qev_t e;
+    unsigned n = 0;
+    while (lane_pop(ctx->frame, &e)){
+        uint64_t lat = mono_ns() - e.t_ns;
+        invoke(ctx, e.evt, e.idx, e.gpio);
+        if (lat > ctx->fstats.latency_max_ns)
+            __atomic_store_n(&ctx->fstats.latency_max_ns, lat, __ATOMIC_RELAXED);
+        n++;
+    }
+    if (!n) return 0;
+    __atomic_fetch_sub(&ctx->frame_pending, n, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&ctx->fstats.events, ctx->fstats.events+n, __ATOMIC_RELAXED);
+    if (tick) __atomic_store_n(&ctx->fstats.frames, ctx->fstats.frames+1, __ATOMIC_RELAXED);
+    else __atomic_store_n(&ctx->fstats.holdback_flushes, ctx->fstats.holdback_flushes+1, __ATOMIC_RELAXED);
+    if (ctx->cfg.no_threads) ctx->emitted += n;
+    return n;
+}
+
+// frame_fd is readable: consume the tick and flush. The fd is the engine's
+// to read (eventfd/timerfd semantics: one 8-byte read clears it).
+static void frame_service(struct btns_ctx *ctx, short revents){
+    if (revents & (POLLERR|POLLHUP|POLLNVAL)){
+        ctx->frame_broken = true;   // never fires again; fall back to hold-back
+        frame_flush(ctx, false);
+        return;
+    }
+    if (revents & POLLIN){
+        uint64_t v;
+        if (read(ctx->cfg.frame_fd, &v, sizeof(v)) < 0) {}
+        frame_flush(ctx, true);
+    }
+}
+
+static void* framer(void *arg){
+    struct btns_ctx *ctx = (struct btns_ctx*)arg;
+    for (;;){
+        struct pollfd pfd[2] = {
+            { .fd = ctx->frame_wake, .events = POLLIN },
+            { .fd = ctx->frame_broken ? -1 : ctx->cfg.frame_fd, .events = POLLIN },
+        };
+        int to = frame_timeout(ctx);
+        if (poll(pfd, 2, to) < 0 && errno != EINTR) break;
+        if (pfd[0].revents & POLLIN){
+            uint64_t v;
+            if (read(ctx->frame_wake, &v, sizeof(v)) < 0) {}
+        }
+        if (!ctx->running) break;
+        if (pfd[1].revents) frame_service(ctx, pfd[1].revents);
+        else if (frame_timeout(ctx)==0) frame_flush(ctx, false);
+    }
+    frame_flush(ctx, false);   // shutdown: nothing is left behind
+    return NULL;
+}
+
+// Producers must be gone (running == 0, alerts removed)
+static void stop_framer(struct btns_ctx *ctx){
+    if (!ctx->frame) return;
+    if (ctx->frame_wake >= 0){
+        uint64_t one = 1;
+        if (write(ctx->frame_wake, &one, sizeof(one)) < 0) {}
+        pthread_join(ctx->framer, NULL);
+        close(ctx->frame_wake);
+    } else {
+        frame_flush(ctx, false);   // no_threads: deliver leftovers here
+    }
+    free(ctx->frame);
+    ctx->frame = NULL;
+}
+
+// Picks the highest non-empty lane before every single event, so a critical
+// event waits for at most one in-flight normal callback.
+static void* dispatcher(void *arg){
+    struct btns_ctx *ctx = (struct btns_ctx*)arg;
+    for (;;){
+        while (sem_wait(&ctx->qsem)!=0) {}
+
+        btn_lane_t *l = NULL;
+        btn_qev_t e;
+        for (int p=BTN_PRIO_COUNT-1;p>=0 && !l;p--)
+            if (lane_pop(&ctx->lanes[p], &e)) l = &ctx->lanes[p];
+        if (!l){
+            if (!ctx->running) break;
+            // Token of a later cell whose producer overtook the one still
+            // publishing the head: keep it for that event, let the slow
+            // producer finish.
+            sem_post(&ctx->qsem);
+            sched_yield();
+            continue;
+        }
+
+        uint64_t lat = mono_ns() - e.t_ns;
+        invoke(ctx, e.evt, e.idx, e.gpio);
+
+        __atomic_store_n(&l->stats.dispatched, l->stats.dispatched+1, __ATOMIC_RELAXED);
+        __atomic_store_n(&l->stats.latency_sum_ns, l->stats.latency_sum_ns+lat, __ATOMIC_RELAXED);
+        if (lat > l->stats.latency_max_ns)
+            __atomic_store_n(&l->stats.latency_max_ns, lat, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// Resume: levels may have changed while edges were not delivered. Read all
+// lines at once and adopt the current state without synthesizing CLICK, HOLD
+// or REPEAT. Only wakeup buttons report a PRESS found at resume.
+static void resync_levels(struct btns_ctx *ctx, btn_shard_t *sh){
+    uint32_t t = now_ms();
+    bool have = gpio_read_levels(sh->gpios, sh->nlines, sh->levels)==0;
+
+    for (unsigned k=0;k<sh->n;k++){
+        unsigned i = sh->idx[k];
+        btn_state_t *b = &ctx->st[i];
+        b->last_edge_ms = t;
+        if (!have){
+            if (b->pressed){ b->down_ms = t; b->last_repeat_ms = t; b->turbo_next = t + b->turbo_ms/2; }
+            continue;
+        }
+        bool down = b->active_low ? (sh->levels[b->slot]==0) : (sh->levels[b->slot]==1);
+        if (b->paired){
+            bool d2 = b->active_low ? (sh->levels[b->pair_slot]==0) : (sh->levels[b->pair_slot]==1);
+            if (b->pair_inverted) d2 = !d2;
+            b->ch[0] = down;
+            b->ch[1] = d2;
+            b->disagree_ms = (down != d2) ? t : 0;
+            down = down && d2 && !b->fault;
+        }
+        if (down && !b->pressed){
+            b->pressed = true;
+            b->down_ms = t;
+            b->last_repeat_ms = t;
+            b->hold_fired = !b->wakeup;
+            b->silent = !b->wakeup;
+            b->turbo_next = t + b->turbo_ms/2;
+            b->turbo_up = false;
+            if (b->wakeup){ emit(ctx, BTN_EVENT_PRESS, i); kick_timers(ctx); }
+        } else if (down){
+            b->down_ms = t;           // held across suspend: restart timing, no burst
+            b->last_repeat_ms = t;
+            b->turbo_next = t + b->turbo_ms/2;
+        } else if (b->pressed){
+            b->pressed = false;
+            if (!b->silent && !b->turbo_up) emit(ctx, BTN_EVENT_RELEASE, i); // balance PRESS, no CLICK
+            b->silent = false;
+            b->turbo_up = false;
+        }
+    }
+}
+
+// Sharded: every shard re-reads its own lines on its own thread
+static void resync_all(struct btns_ctx *ctx){
+    if (!ctx->sharded){ resync_levels(ctx, ctx->sh); return; }
+    for (unsigned k=0;k<ctx->nsh;k++){
+        __atomic_store_n(&ctx->sh[k].resync, 1, __ATOMIC_RELEASE);
+        waker_kick(&ctx->sh[k].wake);
+    }
+}
+
+// Called from both the alert path and the worker; only one caller wins the
+// exchange and resyncs.
+static void check_resume(struct btns_ctx *ctx){
+    uint32_t s = suspended_ms();
+    uint32_t prev = __atomic_load_n(&ctx->susp_ms, __ATOMIC_RELAXED);
+    // Signed: the two clocks are read one after the other and truncated to
+    // ms, so the difference jitters by -1 without any suspend
+    if ((int32_t)(s - prev) < BTNS_SUSPEND_GAP_MS) return;
+    if (__atomic_compare_exchange_n(&ctx->susp_ms, &prev, s, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        resync_all(ctx);
+}
+
+static int find_index(struct btns_ctx *ctx, btn_shard_t *sh, unsigned gpio, int *ch){
+    for (unsigned k=0;k<sh->n;k++){
+        unsigned i = sh->idx[k];
+        if (ctx->st[i].gpio == gpio){ *ch = 0; return (int)i; }
+        if (ctx->st[i].paired && ctx->st[i].pair_gpio == gpio){ *ch = 1; return (int)i; }
+    }
+    return -1;
+}
 
+static void apply_press(struct btns_ctx *ctx, int idx, bool logical_press, uint32_t t){
+    btn_state_t *b = &ctx->st[idx];
     if (logical_press){
         b->pressed = true;
         b->down_ms = t;
         b->hold_fired = false;
         b->last_repeat_ms = t;
-        if (ctx->cfg.on_event) ctx->cfg.on_event(ctx->cfg.user, BTN_EVENT_PRESS, (unsigned)idx, b->gpio);
+        b->silent = false;
+        b->turbo_next = t + b->turbo_ms/2;
+        b->turbo_up = false;
+        emit(ctx, BTN_EVENT_PRESS, (unsigned)idx);
+        kick_timers(ctx);
     } else {
-        bool was = b->pressed;
+        bool was = b->pressed && !b->silent;
+        bool up = b->turbo_up;   // autofire already released it
         b->pressed = false;
+        b->silent = false;
+        b->turbo_up = false;
         if (was){
-            if (ctx->cfg.on_event) ctx->cfg.on_event(ctx->cfg.user, BTN_EVENT_RELEASE,(unsigned)idx,b->gpio);
+            if (!up) emit(ctx, BTN_EVENT_RELEASE, (unsigned)idx);
             uint32_t dur = t - b->down_ms;
-            if (dur < ctx->cfg.hold_ms){
-                if (ctx->cfg.on_event) ctx->cfg.on_event(ctx->cfg.user, BTN_EVENT_CLICK,(unsigned)idx,b->gpio);
+            if (dur < ctx->cfg.hold_ms && !b->turbo_ms){
+                emit(ctx, BTN_EVENT_CLICK, (unsigned)idx);
             }
         }
     }
 }
 
-static void* worker(void *arg){
-    struct btns_ctx *ctx = (struct btns_ctx*)arg;
-    const unsigned poll = 10; // ms
-    while (ctx->running){
-        uint32_t t = gpio_now_ms();
-        for (unsigned i=0;i<ctx->cfg.count;i++){
-            btn_state_t *b = &ctx->st[i];
-            if (b->pressed){
-                uint32_t held = t - b->down_ms;
-                if (!b->hold_fired && held >= ctx->cfg.hold_ms){
-                    b->hold_fired = true;
-                    if (ctx->cfg.on_event) ctx->cfg.on_event(ctx->cfg.user, BTN_EVENT_HOLD, i, b->gpio);
+// Discrepancy: report FAULT and drive the button to its safe (released) state.
+static void pair_fault(struct btns_ctx *ctx, unsigned idx){
+    btn_state_t *b = &ctx->st[idx];
+    b->fault = true;
+    b->disagree_ms = 0;
+    emit(ctx, BTN_EVENT_FAULT, idx);
+    if (b->pressed){
+        bool was = !b->silent && !b->turbo_up;
+        b->pressed = false;
+        b->silent = false;
+        b->turbo_up = false;
+        if (was) emit(ctx, BTN_EVENT_RELEASE, idx);
+    }
+}
+
+static bool soft_debounce(struct btns_ctx *ctx){
+    return __atomic_load_n(&ctx->debounce, __ATOMIC_RELAXED) != BTNS_DEBOUNCE_KERNEL;
+}
+
+// Glitch filter period for the current strategy
+static unsigned glitch_us(struct btns_ctx *ctx, int mode){
+    if (mode == BTNS_DEBOUNCE_SOFTWARE) return 0;
+    return (ctx->cfg.debounce_ms ? ctx->cfg.debounce_ms : 10) * 1000u;
+}
+
+// Dual-channel edge. Both channels come from the same backend batch, so
+// their ticks are comparable: the transition fires when the second channel
+// follows within the window (latency <= window), FAULT if it follows late.
+// A channel that never follows is caught by the worker tick.
+static void pair_edge(struct btns_ctx *ctx, unsigned idx, int ch, bool press, uint32_t tick, uint32_t t){
+    btn_state_t *b = &ctx->st[idx];
+    if (soft_debounce(ctx) && (t - b->ch_edge_ms[ch]) < ctx->cfg.debounce_ms) return;
+    b->ch_edge_ms[ch] = t;
+    b->ch[ch] = press;
+    b->ch_tick[ch] = tick;
+
+    if (b->ch[0] != b->ch[1]){
+        if (!b->disagree_ms){ b->disagree_ms = t ? t : 1; kick_timers(ctx); }
+        return;
+    }
+    b->disagree_ms = 0;
+
+    if (b->fault){
+        if (!press) b->fault = false;   // both released again: recovered
+        return;
+    }
+    uint32_t skew_us = b->ch_tick[ch] - b->ch_tick[!ch];
+    if (skew_us > ctx->cfg.pair_window_ms * 1000u){ pair_fault(ctx, idx); return; }
+    if (press != b->pressed) apply_press(ctx, (int)idx, press, t);
+}
+
+// O(1) per edge whatever the burst size: count, classify, defer the decision.
+static void noise_edge(struct btns_ctx *ctx, unsigned idx, int level, uint32_t t){
+    btn_state_t *b = &ctx->st[idx];
+    if ((t - b->nz_start_ms) > ctx->cfg.noise_window_ms){
+        b->nz_start_ms = t;
+        b->nz_count = 0;
+    }
+    b->nz_count++;
+    b->nz_last_ms = t;
+    if (!b->nz_pending){ b->nz_pending = true; kick_timers(ctx); }
+    if (!b->noisy && (level==BTNS_LEVEL_NOISE || b->nz_count >= ctx->cfg.noise_edges)){
+        b->noisy = true;
+        emit(ctx, BTN_EVENT_NOISE, idx);
+    }
+}
+
+// Quiet time before a filtered line is confirmed (>= 1 ms, so a failing
+// level read is retried at most once per ms)
+static uint32_t nz_settle(const struct btns_ctx *ctx, const btn_state_t *b){
+    uint32_t settle = b->noisy ? ctx->cfg.noise_window_ms : ctx->cfg.debounce_ms;
+    return settle ? settle : 1;
+}
+
+// Worker tick: lines quiet for debounce_ms (clean edge) or noise_window_ms
+// (after a burst) get their state confirmed by a single bulk level read.
+static void noise_confirm(struct btns_ctx *ctx, btn_shard_t *sh, uint32_t t){
+    bool read = false, have = false;
+    for (unsigned k=0;k<sh->n;k++){
+        unsigned i = sh->idx[k];
+        btn_state_t *b = &ctx->st[i];
+        if (!b->nz_pending) continue;
+        uint32_t settle = nz_settle(ctx, b);
+        if ((t - b->nz_last_ms) < settle) continue;
+        if (!read){
+            have = gpio_read_levels(sh->gpios, sh->nlines, sh->levels)==0;
+            read = true;
+        }
+        if (!have){ b->nz_last_ms = t; continue; }   // read failed: retry one settle period later
+        b->nz_pending = false;
+        b->noisy = false;
+        b->nz_count = 0;
+        bool down = b->active_low ? (sh->levels[b->slot]==0) : (sh->levels[b->slot]==1);
+        if (down != b->pressed) apply_press(ctx, (int)i, down, t);
+    }
+}
+
+// Edge on a known line: noise filter, channel pairing or debounce, then
+// PRESS/RELEASE. t = arrival time (ms).
+static void line_edge(struct btns_ctx *ctx, int idx, int ch, int level, uint32_t tick, uint32_t t){
+    btn_state_t *b = &ctx->st[idx];
+    if (b->nf && !b->paired){
+        noise_edge(ctx, (unsigned)idx, level, t);
+        return;
+    }
+    if (level==BTNS_LEVEL_NOISE) return;   // not a level; only the filter uses it
+    bool logical_press = b->active_low ? (level==0) : (level==1);
+
+    if (b->paired){
+        if (ch==1 && b->pair_inverted) logical_press = !logical_press;
+        pair_edge(ctx, (unsigned)idx, ch, logical_press, tick, t);
+        return;
+    }
+
+    // Yazılımsal debounce (KERNEL modunda sadece glitch filter)
+    if (soft_debounce(ctx) && (t - b->last_edge_ms) < ctx->cfg.debounce_ms) return;
+    b->last_edge_ms = t;
+
+    apply_press(ctx, idx, logical_press, t);
+}
+
+static void global_alert(int gpio, int level, uint32_t tick, void *userdata){
+    struct btns_ctx *ctx = (struct btns_ctx*)userdata;
+    if (!ctx) return;
+    int ch = 0;
+    int idx = find_index(ctx, ctx->sh, (unsigned)gpio, &ch);
+    if (idx<0) return;
+
+    check_resume(ctx);
+    line_edge(ctx, idx, ch, level, tick, now_ms());
+}
+
+static void timer_fired(btn_shard_t *sh, uint32_t late_ms){
+    sh->tstats.timers_fired++;
+    if (late_ms > sh->tstats.late_max_ms) sh->tstats.late_max_ms = late_ms;
+}
+
+// Report every threshold passed since the last activity, in order
+static void idle_check(struct btns_ctx *ctx, uint32_t t, bool held){
+    if (held){ __atomic_store_n(&ctx->last_act_ms, t, __ATOMIC_RELAXED); return; }
+    uint32_t quiet = t - __atomic_load_n(&ctx->last_act_ms, __ATOMIC_RELAXED);
+    unsigned lvl = __atomic_load_n(&ctx->idle_level, __ATOMIC_ACQUIRE);
+    while (lvl < ctx->cfg.idle_count && quiet >= ctx->idle_ms[lvl]){
+        // Lost race with ACTIVITY (level reset by an edge): stop
+        if (!__atomic_compare_exchange_n(&ctx->idle_level, &lvl, lvl+1, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return;
+        deliver(ctx, BTN_EVENT_IDLE, lvl, BTNS_NO_GPIO, BTN_PRIO_NORMAL);
+        lvl++;
+    }
+}
+
+// Autofire phase toggle. The schedule stays anchored to the press, so a late
+// wakeup does not shift later pairs; whole periods missed (stalled callback)
+// are dropped rather than replayed as a burst.
+static void turbo_tick(struct btns_ctx *ctx, btn_shard_t *sh, unsigned idx, uint32_t t){
+    btn_state_t *b = &ctx->st[idx];
+    int32_t late = (int32_t)(t - b->turbo_next);
+    if (late < 0) return;
+    b->turbo_up = !b->turbo_up;
+    emit(ctx, b->turbo_up ? BTN_EVENT_RELEASE : BTN_EVENT_PRESS, idx);
+    timer_fired(sh, (uint32_t)late);
+    b->turbo_next += b->turbo_up ? b->turbo_ms - b->turbo_ms/2 : b->turbo_ms/2;
+    while ((int32_t)(t - b->turbo_next) >= 0) b->turbo_next += b->turbo_ms;
+}
+
+// Due HOLD/REPEAT, turbo, pair discrepancy and noise-confirm timers of one
+// shard's buttons; true if one of them is held.
+static bool shard_timers(struct btns_ctx *ctx, btn_shard_t *sh, uint32_t t){
+    bool held = false;
+    if (ctx->nfilter) noise_confirm(ctx, sh, t);
+    for (unsigned k=0;k<sh->n;k++){
+        unsigned i = sh->idx[k];
+        btn_state_t *b = &ctx->st[i];
+        if (b->pressed && !b->silent) held = true;
+        if (b->disagree_ms && (t - b->disagree_ms) > ctx->cfg.pair_window_ms)
+            pair_fault(ctx, i);
+        if (b->pressed && !b->silent && b->turbo_ms){
+            turbo_tick(ctx, sh, i, t);
+        } else if (b->pressed && !b->silent){
+            uint32_t held = t - b->down_ms;
+            if (!b->hold_fired && held >= ctx->cfg.hold_ms){
+                b->hold_fired = true;
+                emit(ctx, BTN_EVENT_HOLD, i);
+                b->last_repeat_ms = t;
+                timer_fired(sh, held - ctx->cfg.hold_ms);
+            }
+            if (b->hold_fired && ctx->cfg.repeat_ms){
+                uint32_t since = t - b->last_repeat_ms;
+                if (since >= ctx->cfg.repeat_ms){
                     b->last_repeat_ms = t;
-                }
-                if (b->hold_fired && ctx->cfg.repeat_ms){
-                    if ((t - b->last_repeat_ms) >= ctx->cfg.repeat_ms){
-                        b->last_repeat_ms = t;
-                        if (ctx->cfg.on_event) ctx->cfg.on_event(ctx->cfg.user, BTN_EVENT_REPEAT, i, b->gpio);
-                    }
+                    emit(ctx, BTN_EVENT_REPEAT, i);
+                    timer_fired(sh, since - ctx->cfg.repeat_ms);
                 }
             }
         }
-        gpio_delay_ms(poll);
+    }
+    return held;
+}
+
+// Worker tick, or btns_process() in no_threads mode: button timers and idle.
+// Sharded, the shard threads run the timers and the merger the idle check.
+static void run_timers(struct btns_ctx *ctx, uint32_t t){
+    if (ctx->sharded) return;
+    bool held = shard_timers(ctx, ctx->sh, t);
+    if (ctx->cfg.idle_count) idle_check(ctx, t, held);
+}
+
+// Deadlines relative to now: earliest one, and the latest one not after limit
+typedef struct {
+    int32_t min;
+    int32_t limit;
+    int32_t max_le;
+} btn_dl_scan_t;
+
+static void dl_add(btn_dl_scan_t *s, uint32_t at, uint32_t t){
+    int32_t d = (int32_t)(at - t);
+    if (d < s->min) s->min = d;
+    if (d <= s->limit && d > s->max_le) s->max_le = d;
+}
+
+// Button deadlines of sh (NULL = none), plus the idle one if asked
+static void dl_collect(struct btns_ctx *ctx, btn_shard_t *sh, bool idle, uint32_t t, btn_dl_scan_t *s){
+    for (unsigned k=0; sh && k<sh->n; k++){
+        btn_state_t *b = &ctx->st[sh->idx[k]];
+        if (b->disagree_ms) dl_add(s, b->disagree_ms + ctx->cfg.pair_window_ms + 1, t);
+        if (b->nz_pending)
+            dl_add(s, b->nz_last_ms + nz_settle(ctx, b), t);
+        if (!b->pressed || b->silent) continue;
+        if (b->turbo_ms) dl_add(s, b->turbo_next, t);
+        else if (!b->hold_fired) dl_add(s, b->down_ms + ctx->cfg.hold_ms, t);
+        else if (ctx->cfg.repeat_ms) dl_add(s, b->last_repeat_ms + ctx->cfg.repeat_ms, t);
+    }
+    if (!idle) return;
+    unsigned lvl = __atomic_load_n(&ctx->idle_level, __ATOMIC_ACQUIRE);
+    if (lvl < ctx->cfg.idle_count)
+        dl_add(s, __atomic_load_n(&ctx->last_act_ms, __ATOMIC_RELAXED) + ctx->idle_ms[lvl], t);
+}
+
+// ms until the next wakeup; -1 = no timer pending. With timer_slack_ms the
+// wakeup moves to the last deadline within slack of the earliest one, so
+// timers of several held buttons are served together (each <= slack late).
+static int next_timeout(struct btns_ctx *ctx, btn_shard_t *sh, bool idle, uint32_t t){
+    btn_dl_scan_t s = { INT32_MAX, INT32_MIN, INT32_MIN };
+    dl_collect(ctx, sh, idle, t, &s);
+    if (s.min == INT32_MAX) return -1;
+    int32_t at = s.min;
+    if (ctx->cfg.timer_slack_ms){
+        s.limit = s.min + (int32_t)ctx->cfg.timer_slack_ms;
+        s.max_le = s.min;
+        dl_collect(ctx, sh, idle, t, &s);
+        at = s.max_le;
+    }
+    return at < 0 ? 0 : (int)at;
+}
+
+static void* worker(void *arg){
+    struct btns_ctx *ctx = (struct btns_ctx*)arg;
+    // Kernel timer slack only for the idle sleep (it would add to the
+    // coalescing window otherwise); pending deadlines use the thread default.
+    unsigned long slack_ns = (unsigned long)ctx->cfg.timer_slack_ms * 1000000ul;
+    unsigned long def_ns = (unsigned long)prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+    bool idle_slack = false;
+    while (ctx->running){
+        check_resume(ctx);
+        run_timers(ctx, now_ms());
+        ctx->tstats.wakeups++;
+
+        // Deadlines are whole CLOCK_MONOTONIC ms: sleep until that ms boundary
+        // rather than now + wait, so periodic timers (turbo) carry no phase
+        // error from where inside the current ms we happen to be.
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint32_t t = (uint32_t)((uint64_t)ts.tv_sec*1000u + (uint64_t)ts.tv_nsec/1000000u);
+        ts.tv_nsec -= ts.tv_nsec % 1000000L;
+        int wait = ctx->sharded ? -1 : next_timeout(ctx, ctx->sh, true, t);
+        bool idle = wait < 0;
+        if (slack_ns && idle != idle_slack){
+            prctl(PR_SET_TIMERSLACK, idle ? slack_ns : def_ns, 0, 0, 0);
+            idle_slack = idle;
+        }
+        if (wait < 0 || wait > BTNS_IDLE_SLEEP_MS) wait = BTNS_IDLE_SLEEP_MS;
+        ts.tv_sec  += wait / 1000;
+        ts.tv_nsec += (long)(wait % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L){ ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+
+        pthread_mutex_lock(&ctx->wlock);
+        while (!ctx->wkick && ctx->running)
+            if (pthread_cond_timedwait(&ctx->wcond, &ctx->wlock, &ts)==ETIMEDOUT) break;
+        ctx->wkick = false;
+        pthread_mutex_unlock(&ctx->wlock);
+    }
+    return NULL;
+}
+
+// Worker thread; with cfg.stack_kb its stack is our own mapping (guard page +
+// optional prefault/mlock) instead of the 8 MB libc default.
+static int start_worker(struct btns_ctx *ctx){
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr)!=0) return -1;
+
+    if (ctx->cfg.stack_kb){
+        size_t pg = (size_t)sysconf(_SC_PAGESIZE);
+        size_t sz = (size_t)ctx->cfg.stack_kb * 1024u;
+        if (sz < (size_t)PTHREAD_STACK_MIN) sz = (size_t)PTHREAD_STACK_MIN;
+        sz = (sz + pg - 1) & ~(pg - 1);
+
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK;
+        if (ctx->cfg.lock_memory) flags |= MAP_POPULATE;
+        void *m = mmap(NULL, sz + pg, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (m == MAP_FAILED){ pthread_attr_destroy(&attr); return -1; }
+        if (mprotect(m, pg, PROT_NONE)!=0){                 // guard (stack grows down)
+            munmap(m, sz + pg);
+            pthread_attr_destroy(&attr);
+            return -1;
+        }
+        if (ctx->cfg.lock_memory) mlock((char*)m + pg, sz); // best effort (RLIMIT_MEMLOCK)
+
+        ctx->stack_map = m;
+        ctx->stack_map_sz = sz + pg;
+        pthread_attr_setstack(&attr, (char*)m + pg, sz);
+    }
+
+    int rc = pthread_create(&ctx->worker, &attr, worker, ctx);
+    pthread_attr_destroy(&attr);
+    if (rc!=0 && ctx->stack_map){
+        munmap(ctx->stack_map, ctx->stack_map_sz);
+        ctx->stack_map = NULL;
+    }
+    return rc;
+}
+
+// ---------- Sharded edge processing (cfg.shards) ----------
+static bool edge_push(btn_edge_ring_t *r, unsigned gpio, int idx, int level, uint32_t tick, uint32_t t){
+    unsigned pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    btn_qedge_t *q;
+    for (;;){
+        q = &r->ev[pos & (BTNS_SHARD_RING-1)];
+        int dif = (int)(__atomic_load_n(&q->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif==0){
+            if (__atomic_compare_exchange_n(&r->tail, &pos, pos+1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (dif<0){
+            return false;   // full
+        } else {
+            pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+        }
+    }
+    q->gpio = gpio;
+    q->idx = idx;
+    q->level = level;
+    q->tick = tick;
+    q->t_ms = t;
+    __atomic_store_n(&q->seq, pos+1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool edge_pop(btn_edge_ring_t *r, btn_qedge_t *out){
+    btn_qedge_t *q = &r->ev[r->head & (BTNS_SHARD_RING-1)];
+    if (__atomic_load_n(&q->seq, __ATOMIC_ACQUIRE) != r->head+1) return false;
+    *out = *q;
+    __atomic_store_n(&q->seq, r->head+BTNS_SHARD_RING, __ATOMIC_RELEASE);
+    r->head++;
+    return true;
+}
+
+static bool edge_pending(btn_edge_ring_t *r){
+    btn_qedge_t *q = &r->ev[r->head & (BTNS_SHARD_RING-1)];
+    return __atomic_load_n(&q->seq, __ATOMIC_ACQUIRE) == r->head+1;
+}
+
+// Back-pressure instead of dropping: a lost edge would desync the button
+static void shard_push(btn_shard_t *sh, unsigned gpio, int idx, int level, uint32_t tick, uint32_t t){
+    while (!edge_push(sh->in, gpio, idx, level, tick, t)){
+        __atomic_fetch_add(&sh->stats.in_full, 1, __ATOMIC_RELAXED);
+        waker_wake(&sh->wake);
+        sched_yield();
+    }
+    waker_wake(&sh->wake);
+}
+
+// Backend callback of a sharded line: only stamps and queues
+static void shard_alert(int gpio, int level, uint32_t tick, void *userdata){
+    btn_shard_t *sh = (btn_shard_t*)userdata;
+    if (!sh) return;
+    shard_push(sh, (unsigned)gpio, -1, level, tick, now_ms());
+}
+
+static void shard_edge(struct btns_ctx *ctx, btn_shard_t *sh, const btn_qedge_t *e){
+    __atomic_store_n(&sh->stats.edges, sh->stats.edges+1, __ATOMIC_RELAXED);
+    if (e->idx >= 0){ apply_press(ctx, e->idx, e->level, e->t_ms); return; }
+    int ch = 0;
+    int idx = find_index(ctx, sh, e->gpio, &ch);
+    if (idx<0) return;
+    check_resume(ctx);
+    if (__atomic_exchange_n(&sh->resync, 0, __ATOMIC_ACQ_REL)) resync_levels(ctx, sh);
+    line_edge(ctx, idx, ch, e->level, e->tick, e->t_ms);
+}
+
+// Drain edges, run own timers, sleep until the next own deadline or an edge
+static void* shard_main(void *arg){
+    btn_shard_t *sh = (btn_shard_t*)arg;
+    struct btns_ctx *ctx = sh->ctx;
+    btn_qedge_t e;
+    for (;;){
+        if (__atomic_exchange_n(&sh->resync, 0, __ATOMIC_ACQ_REL)) resync_levels(ctx, sh);
+        while (edge_pop(sh->in, &e)) shard_edge(ctx, sh, &e);
+        if (__atomic_load_n(&ctx->shard_stop, __ATOMIC_ACQUIRE) && !edge_pending(sh->in)) break;
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint32_t t = (uint32_t)((uint64_t)ts.tv_sec*1000u + (uint64_t)ts.tv_nsec/1000000u);
+        shard_timers(ctx, sh, t);
+        int wait = next_timeout(ctx, sh, false, t);
+        ts.tv_nsec -= ts.tv_nsec % 1000000L;   // whole-ms deadlines, as in worker()
+        if (wait >= 0){
+            ts.tv_sec  += wait / 1000;
+            ts.tv_nsec += (long)(wait % 1000) * 1000000L;
+            if (ts.tv_nsec >= 1000000000L){ ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+        }
+
+        waker_arm(&sh->wake);
+        if (wait==0 || edge_pending(sh->in) || __atomic_load_n(&sh->resync, __ATOMIC_ACQUIRE) ||
+            __atomic_load_n(&ctx->shard_stop, __ATOMIC_ACQUIRE)){
+            waker_disarm(&sh->wake);
+            continue;
+        }
+        waker_wait(&sh->wake, wait > 0 ? &ts : NULL);
+        sh->tstats.wakeups++;
+    }
+    return NULL;
+}
+
+// Sharded inactivity is the merger's: the first activity it delivers after an
+// IDLE (or the shard's ACTIVITY marker) is preceded by ACTIVITY, in delivery
+// order. Returns false for a marker that has nothing left to report.
+static bool merge_activity(struct btns_ctx *ctx, const btn_qev_t *e){
+    if (!ctx->cfg.idle_count || e->evt==BTN_EVENT_NOISE || e->evt==BTN_EVENT_FAULT) return true;
+    if (__atomic_exchange_n(&ctx->idle_level, 0, __ATOMIC_ACQ_REL)){
+        if (wanted(ctx, BTN_EVENT_ACTIVITY, e->idx))
+            route(ctx, BTN_EVENT_ACTIVITY, e->idx, e->gpio, ctx->st[e->idx].prio);
+    }
+    return e->evt!=BTN_EVENT_ACTIVITY;
+}
+
+// Idle thresholds, once the rings are drained; "held" is a read-only look at
+// the shards' buttons. Absolute wakeup for the next threshold in *until.
+static bool merge_idle(struct btns_ctx *ctx, struct timespec *until){
+    if (!ctx->cfg.idle_count) return false;
+    bool held = false;
+    for (unsigned i=0; !held && i<ctx->cfg.count; i++)
+        held = ctx->st[i].pressed && !ctx->st[i].silent;
+    clock_gettime(CLOCK_MONOTONIC, until);
+    uint32_t t = (uint32_t)((uint64_t)until->tv_sec*1000u + (uint64_t)until->tv_nsec/1000000u);
+    idle_check(ctx, t, held);   // held restarts the clock: re-checked a threshold later
+    int wait = next_timeout(ctx, NULL, true, t);
+    if (wait < 0) return false;
+    until->tv_nsec -= until->tv_nsec % 1000000L;
+    until->tv_sec  += wait / 1000;
+    until->tv_nsec += (long)(wait % 1000) * 1000000L;
+    if (until->tv_nsec >= 1000000000L){ until->tv_sec++; until->tv_nsec -= 1000000000L; }
+    return true;
+}
+
+// Oldest visible head across the shards' rings. A button's events only enter
+// its own shard's ring, so they leave in order; across shards the order is by
+// generation time as far as it is visible. IDLE is sent from here too, so it
+// cannot overtake (or be overtaken by) the events around it.
+static void* merger(void *arg){
+    struct btns_ctx *ctx = (struct btns_ctx*)arg;
+    for (;;){
+        btn_lane_t *best = NULL;
+        uint64_t best_ns = 0;
+        for (unsigned k=0;k<ctx->nsh;k++){
+            uint64_t t = lane_oldest_ns(ctx->sh[k].out);
+            if (t && (!best || t < best_ns)){ best = ctx->sh[k].out; best_ns = t; }
+        }
+        if (best){
+            btn_qev_t e;
+            if (!lane_pop(best, &e)) continue;
+            if (merge_activity(ctx, &e)) route(ctx, e.evt, e.idx, e.gpio, ctx->st[e.idx].prio);
+            continue;
+        }
+        if (__atomic_load_n(&ctx->merge_stop, __ATOMIC_ACQUIRE)) break;
+        struct timespec until;
+        bool timed = merge_idle(ctx, &until);
+        waker_arm(&ctx->mwake);
+        bool any = __atomic_load_n(&ctx->merge_stop, __ATOMIC_ACQUIRE);
+        for (unsigned k=0; !any && k<ctx->nsh; k++) any = lane_oldest_ns(ctx->sh[k].out) != 0;
+        if (any){ waker_disarm(&ctx->mwake); continue; }
+        waker_wait(&ctx->mwake, timed ? &until : NULL);
     }
     return NULL;
 }
 
+static void shards_free(struct btns_ctx *ctx){
+    for (unsigned k=0; ctx->sh && k<ctx->nsh; k++){
+        btn_shard_t *sh = &ctx->sh[k];
+        free(sh->idx); free(sh->gpios); free(sh->levels);
+        free(sh->in); free(sh->out);
+    }
+    free(ctx->sh);
+    ctx->sh = NULL;
+    ctx->nsh = 0;
+}
+
+// Button -> shard by btn_pin_t.group when any pin sets one (a chip stays on
+// one shard), else contiguous index blocks. Own lines first, in index order,
+// then the pair lines: one gpio_read_levels() covers a shard.
+static int shards_build(struct btns_ctx *ctx, unsigned nsh){
+    bool grouped = false;
+    for (unsigned i=0;i<ctx->cfg.count;i++) if (ctx->cfg.pins[i].group) grouped = true;
+    ctx->sh = aligned_alloc(64, nsh * sizeof(btn_shard_t));
+    if (!ctx->sh) return -1;
+    memset(ctx->sh, 0, nsh * sizeof(btn_shard_t));
+    ctx->nsh = nsh;
+    for (unsigned i=0;i<ctx->cfg.count;i++){
+        btn_state_t *b = &ctx->st[i];
+        b->shard = grouped ? ctx->cfg.pins[i].group % nsh : (unsigned)((uint64_t)i * nsh / ctx->cfg.count);
+        ctx->sh[b->shard].nlines += b->paired ? 2 : 1;
+    }
+    for (unsigned k=0;k<nsh;k++){
+        btn_shard_t *sh = &ctx->sh[k];
+        unsigned cap = sh->nlines ? sh->nlines : 1;
+        sh->ctx = ctx;
+        sh->idx = calloc(cap, sizeof(unsigned));
+        sh->gpios = calloc(cap, sizeof(unsigned));
+        sh->levels = calloc(cap, sizeof(int));
+        if (!sh->idx || !sh->gpios || !sh->levels) return -1;
+    }
+    for (unsigned i=0;i<ctx->cfg.count;i++){
+        btn_state_t *b = &ctx->st[i];
+        btn_shard_t *sh = &ctx->sh[b->shard];
+        b->slot = sh->n++;
+        sh->idx[b->slot] = i;
+        sh->gpios[b->slot] = b->gpio;
+    }
+    for (unsigned k=0;k<nsh;k++) ctx->sh[k].nlines = ctx->sh[k].n;
+    for (unsigned i=0;i<ctx->cfg.count;i++){
+        btn_state_t *b = &ctx->st[i];
+        if (!b->paired) continue;
+        btn_shard_t *sh = &ctx->sh[b->shard];
+        b->pair_slot = sh->nlines++;
+        sh->gpios[b->pair_slot] = b->pair_gpio;
+    }
+    return 0;
+}
+
+// Shards [0, n) were started; they drain their rings and exit
+static void join_shards(struct btns_ctx *ctx, unsigned n){
+    __atomic_store_n(&ctx->shard_stop, 1, __ATOMIC_RELEASE);
+    for (unsigned k=0;k<n;k++) waker_kick(&ctx->sh[k].wake);
+    for (unsigned k=0;k<n;k++){
+        pthread_join(ctx->sh[k].thread, NULL);
+        waker_destroy(&ctx->sh[k].wake);
+    }
+}
+
+// All or nothing: on failure the started threads are stopped again
+static int start_shards(struct btns_ctx *ctx){
+    ctx->sharded = true;
+    unsigned k;
+    for (k=0;k<ctx->nsh;k++){
+        btn_shard_t *sh = &ctx->sh[k];
+        sh->in = calloc(1, sizeof(btn_edge_ring_t));
+        sh->out = calloc(1, sizeof(btn_lane_t));
+        if (!sh->in || !sh->out) break;
+        for (unsigned j=0;j<BTNS_SHARD_RING;j++) sh->in->ev[j].seq = j;
+        for (unsigned j=0;j<BTNS_QUEUE_LEN;j++) sh->out->ev[j].seq = j;
+        waker_init(&sh->wake);
+        if (pthread_create(&sh->thread, NULL, shard_main, sh)!=0){ waker_destroy(&sh->wake); break; }
+    }
+    if (k==ctx->nsh){
+        waker_init(&ctx->mwake);
+        if (pthread_create(&ctx->merger, NULL, merger, ctx)==0) return 0;
+        waker_destroy(&ctx->mwake);
+    }
+    join_shards(ctx, k);
+    ctx->sharded = false;
+    return -1;
+}
+
+// Alerts must be removed: shards drain, then the merger delivers the rest
+static void stop_shards(struct btns_ctx *ctx){
+    if (!ctx->sharded) return;
+    join_shards(ctx, ctx->nsh);
+    __atomic_store_n(&ctx->merge_stop, 1, __ATOMIC_RELEASE);
+    waker_kick(&ctx->mwake);
+    pthread_join(ctx->merger, NULL);
+    waker_destroy(&ctx->mwake);
+}
+
 btns_ctx_t* btns_create(const btns_config_t *cfg){
     if (!cfg || !cfg->pins || cfg->count==0) return NULL;
+    if ((unsigned)cfg->debounce_mode > BTNS_DEBOUNCE_SOFTWARE) return NULL;
     if (gpio_backend_init()!=0) return NULL;
 
     struct btns_ctx *ctx = calloc(1, sizeof(*ctx));
     ctx->cfg = *cfg;
+    ctx->debounce = cfg->debounce_mode;
+    if (!ctx->cfg.pair_window_ms) ctx->cfg.pair_window_ms = BTNS_PAIR_WINDOW_DEFAULT_MS;
+    if (!ctx->cfg.noise_edges) ctx->cfg.noise_edges = BTNS_NOISE_EDGES_DEFAULT;
+    if (!ctx->cfg.noise_window_ms) ctx->cfg.noise_window_ms = BTNS_NOISE_WINDOW_DEFAULT_MS;
     ctx->st  = calloc(cfg->count, sizeof(btn_state_t));
+    ctx->susp_ms = suspended_ms();
+    ctx->start_ms = now_ms();
+    ctx->last_act_ms = ctx->start_ms;
+    if (!cfg->idle_ms) ctx->cfg.idle_count = 0;
+    if (ctx->cfg.idle_count){
+        ctx->idle_ms = calloc(ctx->cfg.idle_count, sizeof(unsigned));
+        if (!ctx->idle_ms) ctx->cfg.idle_count = 0;
+        for (unsigned i=0;i<ctx->cfg.idle_count;i++) ctx->idle_ms[i] = cfg->idle_ms[i];
+        ctx->cfg.idle_ms = ctx->idle_ms;
+    }
+    pthread_mutex_init(&ctx->wlock, NULL);
+    pthread_mutex_init(&ctx->sublock, NULL);
+    ctx->budget_ns = (uint64_t)cfg->cb_budget_us * 1000u;
+    ctx->cb_main.id = BTNS_CB_ON_EVENT;
+    if (ctx->budget_ns) ctx->cbstats = &ctx->cb_main;
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctx->wcond, &ca);
+    pthread_condattr_destroy(&ca);
+    ctx->frame_wake = -1;
+    if (cfg->frame_sync){
+        ctx->frame = calloc(1, sizeof(btn_lane_t));
+        for (unsigned k=0; ctx->frame && k<BTNS_QUEUE_LEN; k++) ctx->frame->ev[k].seq = k;
+        if (ctx->frame && !cfg->no_threads){
+            ctx->frame_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (ctx->frame_wake < 0){ free(ctx->frame); ctx->frame = NULL; }
+        }
+    }
+    ctx->fd = -1;
+    if (cfg->no_threads){
+        int fd = gpio_get_fd();   // -ENOTSUP: alerts stay on the backend's context
+        ctx->fd = fd>=0 ? fd : -1;
+    }
+
+    if (cfg->lock_memory){
+        // Hot state: touched on every edge and every worker tick
+        memset(ctx->st, 0, cfg->count * sizeof(btn_state_t));
+        mlock(ctx, sizeof(*ctx));
+        mlock(ctx->st, cfg->count * sizeof(btn_state_t));
+    }
 
     for (unsigned i=0;i<cfg->count;i++){
         const btn_pin_t *p = &cfg->pins[i];
@@ -105,34 +1385,134 @@ btns_ctx_t* btns_create(const btns_config_t *cfg){
         b->gpio = p->gpio;
         b->active_low = p->active_low;
         b->pull = p->enable_pull ? (p->active_low ? 1 : 2) : 0;
+        b->wakeup = p->wakeup;
+        b->turbo_ms = p->turbo_ms ? (p->turbo_ms >= 2 ? p->turbo_ms : 2) : 0;
+        b->nf = p->noise_filter && !p->paired;
+        if (b->nf) ctx->nfilter = true;
+        b->prio = p->priority < BTN_PRIO_COUNT ? p->priority : BTN_PRIO_CRITICAL;
+        if (b->prio != BTN_PRIO_NORMAL && !ctx->lanes && !cfg->no_threads){
+            ctx->lanes = calloc(BTN_PRIO_COUNT, sizeof(btn_lane_t));
+            for (unsigned p=0; ctx->lanes && p<BTN_PRIO_COUNT; p++)
+                for (unsigned k=0;k<BTNS_QUEUE_LEN;k++) ctx->lanes[p].ev[k].seq = k;
+        }
 
         gpio_set_mode_input(p->gpio);
         gpio_set_pull(p->gpio, b->pull);
 
-        unsigned us = (cfg->debounce_ms ? cfg->debounce_ms : 10) * 1000u;
+        unsigned us = glitch_us(ctx, ctx->debounce);
         gpio_set_glitch_filter(p->gpio, us);
+        if (p->wakeup) gpio_set_wakeup(p->gpio, 1); // best effort
 
-        // ÖNEMLİ: Backend sarmalayıcıyı kullan
-        gpio_set_alert(p->gpio, global_alert, ctx);
+        if (p->paired){
+            b->paired = true;
+            b->pair_gpio = p->pair_gpio;
+            b->pair_inverted = p->pair_inverted;
+            gpio_set_mode_input(p->pair_gpio);
+            gpio_set_pull(p->pair_gpio, b->pull);
+            gpio_set_glitch_filter(p->pair_gpio, us);
+        }
     }
 
     ctx->running = 1;
-    if (pthread_create(&ctx->worker, NULL, worker, ctx)!=0){
+    if (ctx->lanes){
+        if (sem_init(&ctx->qsem, 0, 0)!=0){
+            free(ctx->lanes); ctx->lanes = NULL;   // fall back to inline dispatch
+        } else if (pthread_create(&ctx->dispatcher, NULL, dispatcher, ctx)!=0){
+            sem_destroy(&ctx->qsem);
+            free(ctx->lanes); ctx->lanes = NULL;
+        }
+    }
+    if (ctx->frame_wake >= 0 && pthread_create(&ctx->framer, NULL, framer, ctx)!=0){
+        close(ctx->frame_wake); ctx->frame_wake = -1;
+        free(ctx->frame); ctx->frame = NULL;       // fall back to immediate delivery
+    }
+    unsigned nsh = (!cfg->no_threads && cfg->shards > 1) ? (cfg->shards < cfg->count ? cfg->shards : cfg->count) : 1;
+    if (shards_build(ctx, nsh)!=0 || (nsh > 1 && start_shards(ctx)!=0)){
+        shards_free(ctx);   // fall back to the alert path + worker
+        shards_build(ctx, 1);
+    }
+    if (!ctx->sh || (!cfg->no_threads && start_worker(ctx)!=0)){
+        ctx->running = 0;
+        stop_shards(ctx);
+        if (ctx->lanes){
+            sem_post(&ctx->qsem);
+            pthread_join(ctx->dispatcher, NULL);
+            sem_destroy(&ctx->qsem);
+            free(ctx->lanes);
+        }
+        stop_framer(ctx);
+        pthread_cond_destroy(&ctx->wcond); pthread_mutex_destroy(&ctx->wlock);
+        pthread_mutex_destroy(&ctx->sublock);
+        free(ctx->idle_ms);
+        shards_free(ctx);
         free(ctx->st); free(ctx); gpio_backend_term(); return NULL;
     }
+
+    // Alerts last: every thread an edge can reach is up
+    for (unsigned i=0;i<cfg->count;i++){
+        const btn_pin_t *p = &cfg->pins[i];
+        btn_shard_t *sh = &ctx->sh[ctx->st[i].shard];
+        // ÖNEMLİ: Backend sarmalayıcıyı kullan
+        if (ctx->sharded) gpio_set_alert(p->gpio, shard_alert, sh);
+        else gpio_set_alert(p->gpio, global_alert, ctx);
+        if (!p->paired) continue;
+        if (ctx->sharded) gpio_set_alert(p->pair_gpio, shard_alert, sh);
+        else gpio_set_alert(p->pair_gpio, global_alert, ctx);
+    }
     return ctx;
 }
 
+static void subs_free(struct btns_ctx *ctx){
+    for (btn_subtab_t *t = ctx->subs, *n; t; t = n){
+        n = t->retired;
+        free(t->off); free(t->ent); free(t);
+    }
+    for (unsigned i=0;i<ctx->nsubreg;i++) free(ctx->subreg[i].buttons);
+    free(ctx->subreg);
+    for (btn_cbstat_t *c = ctx->cbstats, *n; c; c = n){
+        n = c->next;
+        if (c != &ctx->cb_main) free(c);
+    }
+    pthread_mutex_destroy(&ctx->sublock);
+}
+
 void btns_destroy(btns_ctx_t *ctx){
     if (!ctx) return;
     ctx->running = 0;
-    pthread_join(ctx->worker, NULL);
+    if (!ctx->cfg.no_threads){
+        kick_worker(ctx);
+        pthread_join(ctx->worker, NULL);
+    }
 
     for (unsigned i=0;i<ctx->cfg.count;i++){
         gpio_set_alert(ctx->cfg.pins[i].gpio, NULL, NULL);
         gpio_set_glitch_filter(ctx->cfg.pins[i].gpio, 0);
+        if (ctx->st[i].wakeup) gpio_set_wakeup(ctx->st[i].gpio, 0);
+        if (ctx->st[i].paired){
+            gpio_set_alert(ctx->st[i].pair_gpio, NULL, NULL);
+            gpio_set_glitch_filter(ctx->st[i].pair_gpio, 0);
+        }
+    }
+    stop_shards(ctx);   // merger may still feed the lanes / frame buffer
+    if (ctx->lanes){
+        // No producers left; the dispatcher drains what is queued and exits
+        sem_post(&ctx->qsem);
+        pthread_join(ctx->dispatcher, NULL);
+        sem_destroy(&ctx->qsem);
+        free(ctx->lanes);
     }
+    stop_framer(ctx);
     gpio_backend_term();
+    if (ctx->stack_map) munmap(ctx->stack_map, ctx->stack_map_sz);
+    if (ctx->cfg.lock_memory){
+        munlock(ctx->st, ctx->cfg.count * sizeof(btn_state_t));
+        munlock(ctx, sizeof(*ctx));
+    }
+    pthread_cond_destroy(&ctx->wcond);
+    pthread_mutex_destroy(&ctx->wlock);
+    subs_free(ctx);
+    free(ctx->idle_ms);
+    shards_free(ctx);
     free(ctx->st);
     free(ctx);
 }
@@ -141,6 +1521,347 @@ bool btns_is_pressed(btns_ctx_t *ctx, unsigned index){
     if (!ctx || index>=ctx->cfg.count) return false;
     return ctx->st[index].pressed;
 }
+
+// ---------- Single-threaded mode (cfg.no_threads) ----------
+int btns_get_fd(btns_ctx_t *ctx){
+    return (ctx && ctx->cfg.no_threads) ? ctx->fd : -1;
+}
+
+int btns_next_timeout_ms(btns_ctx_t *ctx){
+    if (!ctx || !ctx->cfg.no_threads) return -1;
+    int wait = next_timeout(ctx, ctx->sh, true, now_ms());
+    if (ctx->frame){
+        int f = frame_timeout(ctx);
+        if (f >= 0 && (wait < 0 || f < wait)) wait = f;
+    }
+    return wait;
+}
+
+int btns_process(btns_ctx_t *ctx, int timeout_ms){
+    if (!ctx || !ctx->cfg.no_threads) return -1;
+    unsigned long before = ctx->emitted;
+
+    int wait = btns_next_timeout_ms(ctx);
+    if (timeout_ms >= 0 && (wait < 0 || timeout_ms < wait)) wait = timeout_ms;
+    struct pollfd pfd[2] = {
+        { .fd = ctx->fd, .events = POLLIN },
+        { .fd = (ctx->frame && !ctx->frame_broken) ? ctx->cfg.frame_fd : -1, .events = POLLIN },
+    };
+    if (pfd[0].fd >= 0 || pfd[1].fd >= 0){
+        if (poll(pfd, 2, wait) < 0 && errno != EINTR) return -1;
+        if ((pfd[0].revents & POLLIN) && gpio_dispatch() < 0) return -1;
+    } else if (wait > 0){
+        gpio_delay_ms((unsigned)wait);   // no fd: only timers can become due
+    }
+
+    check_resume(ctx);
+    run_timers(ctx, now_ms());
+    ctx->tstats.wakeups++;
+    // Frame last, so the batch includes what this pass produced
+    if (ctx->frame){
+        if (pfd[1].revents) frame_service(ctx, pfd[1].revents);
+        else if (frame_timeout(ctx)==0) frame_flush(ctx, false);
+    }
+    return (int)(ctx->emitted - before);
+}
+
+// ---------- Vertical-counter debounce ----------
+#define BTNS_VDB_PLANES 4   // counter bits -> up to 15 samples
+
+// Per word: [0] = debounced state, [1..planes] = counter bit-planes
+struct btns_vdebounce {
+    unsigned  nbits;
+    unsigned  words;
+    unsigned  planes;
+    unsigned  samples;
+    uint64_t *w;
+};
+
+btns_vdebounce_t *btns_vdebounce_create(unsigned nbits, unsigned samples){
+    if (!nbits || !samples || samples>BTNS_VDEBOUNCE_MAX_SAMPLES) return NULL;
+    btns_vdebounce_t *vd = calloc(1, sizeof(*vd));
+    if (!vd) return NULL;
+    vd->nbits = nbits;
+    vd->words = (nbits + 63) / 64;
+    vd->samples = samples;
+    vd->planes = 1;
+    while ((1u << vd->planes) <= samples) vd->planes++;
+    vd->w = calloc((size_t)vd->words * (1 + vd->planes), sizeof(uint64_t));
+    if (!vd->w){ free(vd); return NULL; }
+    return vd;
+}
+
+void btns_vdebounce_destroy(btns_vdebounce_t *vd){
+    if (!vd) return;
+    free(vd->w);
+    free(vd);
+}
+
+unsigned btns_vdebounce_update(btns_vdebounce_t *vd, const uint64_t *raw, uint64_t *changed){
+    const unsigned stride = 1 + vd->planes;
+    const unsigned n = vd->samples;
+    unsigned toggled = 0;
+    for (unsigned i=0;i<vd->words;i++){
+        uint64_t *w = &vd->w[(size_t)i * stride];
+        uint64_t d = raw[i] ^ w[0];     // differs from debounced state
+
+        // counter += 1 where d, counter = 0 where !d (ripple carry over planes)
+        uint64_t carry = d, eq = d;
+        for (unsigned k=0;k<vd->planes;k++){
+            uint64_t c = w[1+k];
+            uint64_t nc = (c ^ carry) & d;
+            carry &= c;
+            w[1+k] = nc;
+            eq &= ((n >> k) & 1u) ? nc : ~nc;
+        }
+        // counter reached n: toggle and restart
+        w[0] ^= eq;
+        for (unsigned k=0;k<vd->planes;k++) w[1+k] &= ~eq;
+
+        if (i == vd->words-1 && (vd->nbits & 63)) eq &= (1ull << (vd->nbits & 63)) - 1;
+        if (changed) changed[i] = eq;
+        toggled += (unsigned)__builtin_popcountll(eq);
+    }
+    return toggled;
+}
+
+const uint64_t *btns_vdebounce_state(const btns_vdebounce_t *vd, uint64_t *out){
+    const unsigned stride = 1 + vd->planes;
+    for (unsigned i=0;i<vd->words;i++) out[i] = vd->w[(size_t)i * stride];
+    return out;
+}
+
+int btns_feed_changes(btns_ctx_t *ctx, unsigned first_index,
+                      const uint64_t *state, const uint64_t *changed, unsigned nbits){
+    if (!ctx || !state || !changed || first_index + nbits > ctx->cfg.count) return -1;
+    uint32_t t = now_ms();
+    for (unsigned wi=0; wi*64 < nbits; wi++){
+        uint64_t m = changed[wi];
+        while (m){
+            unsigned bit = (unsigned)__builtin_ctzll(m);
+            m &= m - 1;
+            unsigned i = wi*64 + bit;
+            if (i >= nbits) break;
+            int idx = (int)(first_index + i), press = (int)((state[wi] >> bit) & 1u);
+            if (ctx->sharded) shard_push(&ctx->sh[ctx->st[idx].shard], BTNS_NO_GPIO, idx, press, 0, t);
+            else apply_press(ctx, idx, press, t);
+        }
+    }
+    return 0;
+}
+
+// ---------- Subscriptions ----------
+static bool sub_matches(const btn_sub_reg_t *r, unsigned evt, unsigned b){
+    if (!(r->events & BTNS_EVT_BIT(evt))) return false;
+    if (!per_button(evt) || !r->buttons) return true;
+    return (r->buttons[b/64] >> (b%64)) & 1u;
+}
+
+// Registry -> table (counting pass, fill pass), published with one store.
+// Caller holds sublock. -1 on allocation failure (old table stays).
+static int subs_compile(struct btns_ctx *ctx){
+    unsigned rows = BTNS_SUB_EVENTS * ctx->cfg.count;
+    btn_subtab_t *t = calloc(1, sizeof(*t));
+    uint32_t *off = calloc(rows+1, sizeof(uint32_t));
+    if (!t || !off){ free(t); free(off); return -1; }
+    for (unsigned evt=0; evt<BTNS_SUB_EVENTS; evt++)
+        for (unsigned b=0; b<ctx->cfg.count; b++){
+            unsigned r = evt*ctx->cfg.count + b, n = 0;
+            if (per_button(evt) || b==0)
+                for (unsigned i=0;i<ctx->nsubreg;i++) n += sub_matches(&ctx->subreg[i], evt, b);
+            off[r+1] = off[r] + n;
+        }
+    t->off = off;
+    t->ent = calloc(off[rows] ? off[rows] : 1, sizeof(btn_sub_t));
+    if (!t->ent){ free(off); free(t); return -1; }
+    for (unsigned evt=0; evt<BTNS_SUB_EVENTS; evt++)
+        for (unsigned b=0; b<ctx->cfg.count; b++){
+            btn_sub_t *e = t->ent + off[evt*ctx->cfg.count + b];
+            if (!per_button(evt) && b) continue;
+            for (unsigned i=0;i<ctx->nsubreg;i++)
+                if (sub_matches(&ctx->subreg[i], evt, b)){
+                    e->fn = ctx->subreg[i].fn;
+                    e->user = ctx->subreg[i].user;
+                    e->stats = ctx->subreg[i].stats;
+                    e++;
+                }
+        }
+    t->retired = ctx->subs;
+    __atomic_store_n(&ctx->subs, t, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int btns_subscribe(btns_ctx_t *ctx, const uint64_t *buttons, uint32_t events,
+                   btns_event_fn fn, void *user){
+    if (!ctx || !fn || !(events & BTNS_EVT_ALL)) return -1;
+    btn_sub_reg_t r = { .events = events & BTNS_EVT_ALL, .fn = fn, .user = user };
+    if (buttons){
+        size_t words = (ctx->cfg.count + 63) / 64;
+        r.buttons = malloc(words * sizeof(uint64_t));
+        if (!r.buttons) return -1;
+        memcpy(r.buttons, buttons, words * sizeof(uint64_t));
+    }
+    if (ctx->budget_ns && !(r.stats = calloc(1, sizeof(btn_cbstat_t)))){ free(r.buttons); return -1; }
+    pthread_mutex_lock(&ctx->sublock);
+    btn_sub_reg_t *reg = realloc(ctx->subreg, (ctx->nsubreg+1) * sizeof(*reg));
+    int id = -1;
+    if (reg){
+        ctx->subreg = reg;
+        r.id = ctx->sub_next_id;
+        if (r.stats) r.stats->id = (unsigned)r.id;
+        reg[ctx->nsubreg++] = r;
+        if (subs_compile(ctx)==0){
+            id = r.id;
+            ctx->sub_next_id++;
+            if (r.stats){ r.stats->next = ctx->cbstats; __atomic_store_n(&ctx->cbstats, r.stats, __ATOMIC_RELEASE); }
+        } else ctx->nsubreg--;
+    }
+    pthread_mutex_unlock(&ctx->sublock);
+    if (id < 0){ free(r.buttons); free(r.stats); }
+    return id;
+}
+
+int btns_unsubscribe(btns_ctx_t *ctx, int id){
+    if (!ctx) return -1;
+    pthread_mutex_lock(&ctx->sublock);
+    unsigned i = 0;
+    while (i<ctx->nsubreg && ctx->subreg[i].id!=id) i++;
+    int rc = -1;
+    if (i<ctx->nsubreg){
+        btn_sub_reg_t r = ctx->subreg[i];
+        memmove(&ctx->subreg[i], &ctx->subreg[i+1], (ctx->nsubreg-i-1) * sizeof(r));
+        ctx->nsubreg--;
+        rc = subs_compile(ctx);
+        if (rc==0) free(r.buttons);
+        else { memmove(&ctx->subreg[i+1], &ctx->subreg[i], (ctx->nsubreg-i) * sizeof(r)); ctx->subreg[i] = r; ctx->nsubreg++; }
+    }
+    pthread_mutex_unlock(&ctx->sublock);
+    return rc;
+}
+
+// ---------- Callback budget ----------
+int btns_get_cb_stats(btns_ctx_t *ctx, unsigned id, btns_cb_stats_t *out){
+    if (!ctx || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&ctx->sublock);
+    btn_cbstat_t *c = ctx->cbstats;
+    while (c && c->id!=id) c = c->next;
+    if (c){
+        const btns_cb_stats_t *s = &c->s;
+        out->calls          = __atomic_load_n(&s->calls, __ATOMIC_RELAXED);
+        out->over_budget    = __atomic_load_n(&s->over_budget, __ATOMIC_RELAXED);
+        out->overrun_events = __atomic_load_n(&s->overrun_events, __ATOMIC_RELAXED);
+        out->max_ns         = __atomic_load_n(&s->max_ns, __ATOMIC_RELAXED);
+        out->sum_ns         = __atomic_load_n(&s->sum_ns, __ATOMIC_RELAXED);
+        for (unsigned k=0;k<BTNS_CB_HIST_BUCKETS;k++)
+            out->hist[k] = __atomic_load_n(&s->hist[k], __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&ctx->sublock);
+    return c ? 0 : -1;
+}
+
+uint64_t btns_cb_stats_percentile(const btns_cb_stats_t *s, double p){
+    uint64_t n = 0;
+    for (unsigned k=0;k<BTNS_CB_HIST_BUCKETS;k++) n += s->hist[k];
+    if (!n) return 0;
+    uint64_t want = (uint64_t)((double)n * p / 100.0 + 0.999999), acc = 0;
+    if (!want) want = 1;
+    for (unsigned k=0;k<BTNS_CB_HIST_BUCKETS;k++){
+        acc += s->hist[k];
+        if (acc >= want){
+            uint64_t up = (2ull << k) - 1;
+            return up < s->max_ns ? up : s->max_ns;
+        }
+    }
+    return s->max_ns;
+}
+
+int btns_get_lane_stats(btns_ctx_t *ctx, unsigned prio, btns_lane_stats_t *out){
+    if (!ctx || !out || prio>=BTN_PRIO_COUNT) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!ctx->lanes) return -1;
+    const btns_lane_stats_t *s = &ctx->lanes[prio].stats;
+    out->dispatched     = __atomic_load_n(&s->dispatched, __ATOMIC_RELAXED);
+    out->dropped        = __atomic_load_n(&s->dropped, __ATOMIC_RELAXED);
+    out->latency_max_ns = __atomic_load_n(&s->latency_max_ns, __ATOMIC_RELAXED);
+    out->latency_sum_ns = __atomic_load_n(&s->latency_sum_ns, __ATOMIC_RELAXED);
+    return 0;
+}
+int btns_get_frame_stats(btns_ctx_t *ctx, btns_frame_stats_t *out){
+    if (!ctx || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!ctx->frame) return -1;
+    out->frames           = __atomic_load_n(&ctx->fstats.frames, __ATOMIC_RELAXED);
+    out->holdback_flushes = __atomic_load_n(&ctx->fstats.holdback_flushes, __ATOMIC_RELAXED);
+    out->events           = __atomic_load_n(&ctx->fstats.events, __ATOMIC_RELAXED);
+    out->latency_max_ns   = __atomic_load_n(&ctx->fstats.latency_max_ns, __ATOMIC_RELAXED);
+    out->dropped          = __atomic_load_n(&ctx->frame->stats.dropped, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// CPU time of one engine thread so far, 0 if its clock can't be read
+static uint64_t thread_cpu_ns(pthread_t th){
+    clockid_t cid;
+    struct timespec ts;
+    if (pthread_getcpuclockid(th, &cid)!=0 || clock_gettime(cid, &ts)!=0) return 0;
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Reader copy; counters may be one tick stale (no lock with the worker)
+int btns_get_timer_stats(btns_ctx_t *ctx, btns_timer_stats_t *out){
+    if (!ctx || !out) return -1;
+    out->wakeups      = __atomic_load_n(&ctx->tstats.wakeups, __ATOMIC_RELAXED);
+    out->timers_fired = 0;
+    out->late_max_ms  = 0;
+    for (unsigned k=0;k<ctx->nsh;k++){
+        const btns_timer_stats_t *s = &ctx->sh[k].tstats;
+        uint32_t late = __atomic_load_n(&s->late_max_ms, __ATOMIC_RELAXED);
+        out->wakeups      += __atomic_load_n(&s->wakeups, __ATOMIC_RELAXED);
+        out->timers_fired += __atomic_load_n(&s->timers_fired, __ATOMIC_RELAXED);
+        if (late > out->late_max_ms) out->late_max_ms = late;
+    }
+    out->uptime_ms    = now_ms() - ctx->start_ms;
+    out->cpu_ns       = ctx->cfg.no_threads ? 0 : thread_cpu_ns(ctx->worker);
+    for (unsigned k=0; ctx->sharded && k<ctx->nsh; k++) out->cpu_ns += thread_cpu_ns(ctx->sh[k].thread);
+    return 0;
+}
+
+int btns_get_shard_stats(btns_ctx_t *ctx, unsigned shard, btns_shard_stats_t *out){
+    if (!ctx || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!ctx->sharded || shard>=ctx->nsh) return -1;
+    const btn_shard_t *sh = &ctx->sh[shard];
+    out->buttons  = sh->n;
+    out->edges    = __atomic_load_n(&sh->stats.edges, __ATOMIC_RELAXED);
+    out->events   = __atomic_load_n(&sh->stats.events, __ATOMIC_RELAXED);
+    out->in_full  = __atomic_load_n(&sh->stats.in_full, __ATOMIC_RELAXED);
+    out->out_full = __atomic_load_n(&sh->out->stats.dropped, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int btns_set_debounce(btns_ctx_t *ctx, btns_debounce_t mode){
+    if (!ctx || (unsigned)mode > BTNS_DEBOUNCE_SOFTWARE) return -1;
+    unsigned us = glitch_us(ctx, mode);
+    for (unsigned i=0;i<ctx->cfg.count;i++){
+        gpio_set_glitch_filter(ctx->st[i].gpio, us);
+        if (ctx->st[i].paired) gpio_set_glitch_filter(ctx->st[i].pair_gpio, us);
+    }
+    __atomic_store_n(&ctx->debounce, (int)mode, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static const char *const DEBOUNCE_NAMES[] = { "both", "kernel", "software" };
+
+const char *btns_debounce_name(btns_debounce_t mode){
+    return (unsigned)mode <= BTNS_DEBOUNCE_SOFTWARE ? DEBOUNCE_NAMES[mode] : "?";
+}
+
+int btns_debounce_parse(const char *name){
+    for (int m=0; name && m<=BTNS_DEBOUNCE_SOFTWARE; m++)
+        if (!strcmp(name, DEBOUNCE_NAMES[m])) return m;
+    return -1;
+}
+
 const char *buttons_version(void) {
     return BUTTONS_VERSION;
 }
@@ -14,6 +14,19 @@ void gpio_set_pull(unsigned gpio, int pull); // 0=OFF, 1=UP, 2=DOWN
 void gpio_set_glitch_filter(unsigned gpio, unsigned us);
 void gpio_set_alert(unsigned gpio, gpio_alert_cb cb, void *userdata);
 
+// Bulk level read (one call for all lines, e.g. resync after resume).
+// levels[i] = 0/1 raw level of gpios[i]; returns 0 or -errno.
+int  gpio_read_levels(const unsigned *gpios, unsigned n, int *levels);
+// Mark a line as system wakeup source; -ENOTSUP if the backend cannot.
+int  gpio_set_wakeup(unsigned gpio, int enable);
+
+// Caller-driven delivery (btns no_threads mode). After gpio_get_fd() alerts
+// are queued instead of running on a backend thread: the fd becomes readable
+// and gpio_dispatch() runs the pending callbacks on the calling thread
+// (returns the number delivered or -errno). -ENOTSUP = async delivery only.
+int  gpio_get_fd(void);
+int  gpio_dispatch(void);
+
 void gpio_delay_ms(unsigned ms);
 uint32_t gpio_now_ms(void);
 
@@ -3,6 +3,10 @@
 // Notes:
 // - Uses gpiod v2 API (gpiod_chip_open, *_debounce_period_us, wait/read edge events)
 // - Do not free single edge events (owned by buffer)
+// - Optional output lines (LED/buzzer) share the input line request; staged
+//   output values are written with one set_values ioctl per event batch
+// - Line settings / line config / request config are only needed to build the
+//   request and are freed as soon as it exists
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,9 +24,10 @@
 
 struct buttons_gpio_ctx {
     struct gpiod_chip              *chip;
-    struct gpiod_line_settings     *ls_in;
-    struct gpiod_line_config       *lc;
-    struct gpiod_request_config    *rc;
+    struct gpiod_line_settings     *ls_in;   // transient: NULL after open
+    struct gpiod_line_settings     *ls_out;  // transient: NULL after open
+    struct gpiod_line_config       *lc;      // transient: NULL after open
+    struct gpiod_request_config    *rc;      // transient: NULL after open
     struct gpiod_line_request      *req;
     struct gpiod_edge_event_buffer *evbuf;
 
@@ -31,8 +36,36 @@ struct buttons_gpio_ctx {
     bool     active_low;
     uint32_t debounce_ms;
     unsigned buf_sz;
+
+    unsigned out_offsets[BUTTONS_MAX_LINES];
+    size_t   out_count;
+    enum gpiod_line_value out_vals[BUTTONS_MAX_LINES];
+    bool     out_dirty;
+    int      fb_out[BUTTONS_MAX_LINES];   // input index -> output index, -1 = none
 };
 
+static int find_input(const struct buttons_gpio_ctx *ctx, unsigned offset)
+{
+    for (size_t i = 0; i < ctx->count; i++)
+        if (ctx->offsets[i] == offset) return (int)i;
+    return -1;
+}
+
+static int find_output(const struct buttons_gpio_ctx *ctx, unsigned offset)
+{
+    for (size_t i = 0; i < ctx->out_count; i++)
+        if (ctx->out_offsets[i] == offset) return (int)i;
+    return -1;
+}
+
+static void free_transient(struct buttons_gpio_ctx *ctx)
+{
+    if (ctx->rc)     { gpiod_request_config_free(ctx->rc);   ctx->rc = NULL; }
+    if (ctx->lc)     { gpiod_line_config_free(ctx->lc);      ctx->lc = NULL; }
+    if (ctx->ls_out) { gpiod_line_settings_free(ctx->ls_out); ctx->ls_out = NULL; }
+    if (ctx->ls_in)  { gpiod_line_settings_free(ctx->ls_in);  ctx->ls_in = NULL; }
+}
+
 static int make_devpath(const char *chip_name, char out[128])
 {
     if (!chip_name || !*chip_name) return -EINVAL;
@@ -50,9 +83,26 @@ int buttons_gpio_open(struct buttons_gpio_ctx **out,
                       bool active_low,
                       unsigned debounce_ms,
                       unsigned event_buf)
+{
+    return buttons_gpio_open_ex(out, chip_name, offsets, count, active_low,
+                                debounce_ms, event_buf, NULL, 0, false);
+}
+
+int buttons_gpio_open_ex(struct buttons_gpio_ctx **out,
+                         const char *chip_name,
+                         const unsigned *offsets,
+                         size_t count,
+                         bool active_low,
+                         unsigned debounce_ms,
+                         unsigned event_buf,
+                         const unsigned *out_offsets,
+                         size_t out_count,
+                         bool out_active_low)
 {
     if (!out || !chip_name || !offsets || !count || count > BUTTONS_MAX_LINES)
         return -EINVAL;
+    if (out_count > BUTTONS_MAX_LINES || (out_count && !out_offsets))
+        return -EINVAL;
 
     *out = NULL;
 
@@ -64,8 +114,16 @@ int buttons_gpio_open(struct buttons_gpio_ctx **out,
     ctx->debounce_ms = debounce_ms ? debounce_ms : 0;
     ctx->buf_sz      = event_buf ? event_buf : 32;
 
-    for (size_t i = 0; i < count; i++)
+    for (size_t i = 0; i < count; i++) {
         ctx->offsets[i] = offsets[i];
+        ctx->fb_out[i]  = -1;
+    }
+
+    ctx->out_count = out_count;
+    for (size_t i = 0; i < out_count; i++) {
+        ctx->out_offsets[i] = out_offsets[i];
+        ctx->out_vals[i]    = GPIOD_LINE_VALUE_INACTIVE;
+    }
 
     char dev[128];
     int rc = make_devpath(chip_name, dev);
@@ -89,6 +147,18 @@ int buttons_gpio_open(struct buttons_gpio_ctx **out,
         rc = -errno ? -errno : -EINVAL; goto fail_open;
     }
 
+    if (ctx->out_count) {
+        ctx->ls_out = gpiod_line_settings_new();
+        if (!ctx->ls_out) { rc = -ENOMEM; goto fail_open; }
+        gpiod_line_settings_set_direction(ctx->ls_out, GPIOD_LINE_DIRECTION_OUTPUT);
+        gpiod_line_settings_set_output_value(ctx->ls_out, GPIOD_LINE_VALUE_INACTIVE);
+        if (out_active_low) gpiod_line_settings_set_active_low(ctx->ls_out, true);
+        if (gpiod_line_config_add_line_settings(ctx->lc, ctx->out_offsets,
+                                                (unsigned)ctx->out_count, ctx->ls_out)) {
+            rc = -errno ? -errno : -EINVAL; goto fail_open;
+        }
+    }
+
     ctx->rc = gpiod_request_config_new();
     if (!ctx->rc) { rc = -ENOMEM; goto fail_open; }
     gpiod_request_config_set_consumer(ctx->rc, "buttons-sdk");
@@ -96,6 +166,7 @@ int buttons_gpio_open(struct buttons_gpio_ctx **out,
 
     ctx->req = gpiod_chip_request_lines(ctx->chip, ctx->rc, ctx->lc);
     if (!ctx->req) { rc = -errno ? -errno : -EIO; goto fail_open; }
+    free_transient(ctx);
 
     ctx->evbuf = gpiod_edge_event_buffer_new(ctx->buf_sz);
     if (!ctx->evbuf) { rc = -ENOMEM; goto fail_open; }
@@ -106,9 +177,7 @@ int buttons_gpio_open(struct buttons_gpio_ctx **out,
 fail_open:
     if (ctx->evbuf) gpiod_edge_event_buffer_free(ctx->evbuf);
     if (ctx->req)   gpiod_line_request_release(ctx->req);
-    if (ctx->rc)    gpiod_request_config_free(ctx->rc);
-    if (ctx->lc)    gpiod_line_config_free(ctx->lc);
-    if (ctx->ls_in) gpiod_line_settings_free(ctx->ls_in);
+    free_transient(ctx);
     if (ctx->chip)  gpiod_chip_close(ctx->chip);
     free(ctx);
     return rc;
@@ -119,9 +188,7 @@ void buttons_gpio_close(struct buttons_gpio_ctx *ctx)
     if (!ctx) return;
     if (ctx->evbuf) gpiod_edge_event_buffer_free(ctx->evbuf);
     if (ctx->req)   gpiod_line_request_release(ctx->req);
-    if (ctx->rc)    gpiod_request_config_free(ctx->rc);
-    if (ctx->lc)    gpiod_line_config_free(ctx->lc);
-    if (ctx->ls_in) gpiod_line_settings_free(ctx->ls_in);
+    free_transient(ctx);
     if (ctx->chip)  gpiod_chip_close(ctx->chip);
     free(ctx);
 }
@@ -148,6 +215,7 @@ int buttons_gpio_poll(struct buttons_gpio_ctx *ctx, int timeout_ms,
     if (n < 0) return -errno ? -errno : -EIO;
     if (n == 0) return 0;
 
+    int rc = 0;
     for (int i = 0; i < n; i++) {
         const struct gpiod_edge_event *cev = gpiod_edge_event_buffer_get_event(ctx->evbuf, i);
         bool rising = (gpiod_edge_event_get_event_type((struct gpiod_edge_event *)cev)
@@ -155,12 +223,30 @@ int buttons_gpio_poll(struct buttons_gpio_ctx *ctx, int timeout_ms,
         unsigned off = gpiod_edge_event_get_line_offset((struct gpiod_edge_event *)cev);
         uint64_t ts_ns = gpiod_edge_event_get_timestamp_ns((struct gpiod_edge_event *)cev);
 
-        int rc = on_event(off, rising, ts_ns, user);
-        if (rc) return rc;
+        int fb = ctx->out_count ? find_input(ctx, off) : -1;
+        if (fb >= 0 && ctx->fb_out[fb] >= 0) {
+            ctx->out_vals[ctx->fb_out[fb]] = rising ? GPIOD_LINE_VALUE_ACTIVE
+                                                    : GPIOD_LINE_VALUE_INACTIVE;
+            ctx->out_dirty = true;
+        }
+
+        rc = on_event(off, rising, ts_ns, user);
+        if (rc) break;
     }
+
+    // One ioctl for all feedback staged by this batch (and by the callbacks)
+    int frc = buttons_gpio_output_flush(ctx);
+    if (rc) return rc;
+    if (frc) return frc;
     return n;
 }
 
+int buttons_gpio_get_fd(struct buttons_gpio_ctx *ctx)
+{
+    if (!ctx || !ctx->req) return -EINVAL;
+    return gpiod_line_request_get_fd(ctx->req);
+}
+
 int buttons_gpio_read_level(struct buttons_gpio_ctx *ctx, unsigned offset, int *level_out)
 {
     if (!ctx || !ctx->req || !level_out) return -EINVAL;
@@ -169,3 +255,66 @@ int buttons_gpio_read_level(struct buttons_gpio_ctx *ctx, unsigned offset, int *
     *level_out = value;
     return 0;
 }
+
+int buttons_gpio_set_feedback(struct buttons_gpio_ctx *ctx, unsigned in_offset, unsigned out_offset)
+{
+    if (!ctx) return -EINVAL;
+    int in  = find_input(ctx, in_offset);
+    int out = find_output(ctx, out_offset);
+    if (in < 0 || out < 0) return -EINVAL;
+    ctx->fb_out[in] = out;
+    return 0;
+}
+
+int buttons_gpio_output_stage(struct buttons_gpio_ctx *ctx, unsigned out_offset, bool on)
+{
+    if (!ctx) return -EINVAL;
+    int out = find_output(ctx, out_offset);
+    if (out < 0) return -EINVAL;
+    ctx->out_vals[out] = on ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+    ctx->out_dirty = true;
+    return 0;
+}
+
+int buttons_gpio_output_flush(struct buttons_gpio_ctx *ctx)
+{
+    if (!ctx || !ctx->req) return -EINVAL;
+    if (!ctx->out_dirty || !ctx->out_count) return 0;
+    if (gpiod_line_request_set_values_subset(ctx->req, ctx->out_count,
+                                             ctx->out_offsets, ctx->out_vals) < 0)
+        return -errno ? -errno : -EIO;
+    ctx->out_dirty = false;
+    return 0;
+}
+
+// ---------- Pipeline source ----------
+struct gpio_source {
+    btns_source_t base;
+    struct buttons_gpio_ctx *gpio;
+};
+
+static int gpio_source_read(btns_source_t *s, btns_pipe_t *p)
+{
+    struct gpio_source *g = (struct gpio_source *)s;
+    return buttons_gpio_poll(g->gpio, 0, btns_pipe_on_edge, p);
+}
+
+static void gpio_source_destroy(btns_source_t *s)
+{
+    free(s);
+}
+
+int btns_source_gpio_open(btns_source_t **out, struct buttons_gpio_ctx *gpio)
+{
+    if (!out || !gpio) return -EINVAL;
+    int fd = buttons_gpio_get_fd(gpio);
+    if (fd < 0) return fd;
+    struct gpio_source *g = calloc(1, sizeof(*g));
+    if (!g) return -ENOMEM;
+    g->base.read = gpio_source_read;
+    g->base.destroy = gpio_source_destroy;
+    g->base.fd = fd;
+    g->gpio = gpio;
+    *out = &g->base;
+    return 0;
+}
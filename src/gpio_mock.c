@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: MIT
+// Simulated GPIO backend (implements gpio_backend.h)
+// Notes:
+// - No hardware access; levels are driven with gpio_mock_set_level() or
+//   replayed from an edge stream with gpio_mock_play()
+// - Alerts fire synchronously on the thread that changes the level, or, once
+//   gpio_get_fd() was called, are queued until gpio_dispatch()
+// - Pull-up lines idle high, everything else idles low
+// - Glitch filter: ignored unless gpio_mock_emulate_filter(true). Then, like
+//   the kernel's debounce, a change is reported (and read back) only once the
+//   line has been stable for the filter period, stamped at that moment, and
+//   only if it differs from the last reported level; a mock thread delivers it
+// - gpio_mock_time_alerts(true): the thread CPU time spent inside synchronous
+//   alert callbacks is summed, i.e. the engine's edge path without the
+//   replay or filter thread around it
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "gpio_mock.h"
+
+struct mock_line {
+    gpio_alert_cb cb;
+    void *user;
+    int   level;
+    unsigned filter_us;   // gpio_set_glitch_filter
+    int      out;         // filtered: last reported level
+    uint64_t due_ns;      // filtered: change pending until then (0 = none)
+};
+
+static struct mock_line lines[GPIO_MOCK_MAX_LINES];
+
+// Queued delivery (gpio_get_fd); a full queue drops the oldest edge
+struct mock_edge {
+    unsigned gpio;
+    int      level;
+    uint32_t tick;
+};
+
+static struct mock_edge queue[GPIO_MOCK_QUEUE_LEN];
+static unsigned q_head, q_tail;
+static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER;
+static int q_fd = -1;
+
+// Glitch filter emulation (f_lock guards level/out/due_ns of filtered lines)
+static bool f_on;
+static bool f_running;
+static pthread_t f_thread;
+static pthread_mutex_t f_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t f_cond;
+
+// Alert CPU accounting (gpio_mock_time_alerts)
+static bool a_timed;
+static uint64_t a_cpu_ns;
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Alert callback, or the queue once gpio_get_fd() was called
+static void deliver(unsigned gpio, int level, uint32_t tick)
+{
+    struct mock_line *l = &lines[gpio];
+    if (q_fd < 0) {
+        if (!l->cb) return;
+        if (!__atomic_load_n(&a_timed, __ATOMIC_RELAXED)) { l->cb((int)gpio, level, tick, l->user); return; }
+        uint64_t t0 = thread_cpu_ns();
+        l->cb((int)gpio, level, tick, l->user);
+        __atomic_fetch_add(&a_cpu_ns, thread_cpu_ns() - t0, __ATOMIC_RELAXED);
+        return;
+    }
+    pthread_mutex_lock(&q_lock);
+    if (q_tail - q_head == GPIO_MOCK_QUEUE_LEN) q_head++;
+    queue[q_tail++ % GPIO_MOCK_QUEUE_LEN] = (struct mock_edge){ gpio, level, tick };
+    uint64_t one = 1;
+    if (write(q_fd, &one, sizeof(one)) < 0) {}   // counter only, overflow is harmless
+    pthread_mutex_unlock(&q_lock);
+}
+
+static void *filter_main(void *arg)
+{
+    (void)arg;
+    static struct mock_edge due[GPIO_MOCK_MAX_LINES];
+    pthread_mutex_lock(&f_lock);
+    while (f_running) {
+        uint64_t now = mono_ns(), next = UINT64_MAX;
+        unsigned n = 0;
+        for (unsigned g = 0; g < GPIO_MOCK_MAX_LINES; g++) {
+            struct mock_line *l = &lines[g];
+            if (!l->due_ns) continue;
+            if (l->due_ns > now) { if (l->due_ns < next) next = l->due_ns; continue; }
+            l->due_ns = 0;
+            if (l->level == l->out) continue;   // bounced back: nothing to report
+            l->out = l->level;
+            if (l->cb) due[n++] = (struct mock_edge){ g, l->level, (uint32_t)(now / 1000u) };
+        }
+        if (n) {
+            pthread_mutex_unlock(&f_lock);
+            for (unsigned i = 0; i < n; i++) deliver(due[i].gpio, due[i].level, due[i].tick);
+            pthread_mutex_lock(&f_lock);
+            continue;
+        }
+        if (next == UINT64_MAX) {
+            pthread_cond_wait(&f_cond, &f_lock);
+        } else {
+            struct timespec ts = { (time_t)(next / 1000000000ull), (long)(next % 1000000000ull) };
+            pthread_cond_timedwait(&f_cond, &f_lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&f_lock);
+    return NULL;
+}
+
+void gpio_mock_emulate_filter(bool on)
+{
+    pthread_mutex_lock(&f_lock);
+    f_on = on;
+    pthread_mutex_unlock(&f_lock);
+}
+
+void gpio_mock_time_alerts(bool on)
+{
+    __atomic_store_n(&a_cpu_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&a_timed, on, __ATOMIC_RELAXED);
+}
+
+uint64_t gpio_mock_alert_cpu_ns(void)
+{
+    return __atomic_load_n(&a_cpu_ns, __ATOMIC_RELAXED);
+}
+
+int gpio_backend_init(void) { return 0; }
+
+void gpio_backend_term(void)
+{
+    pthread_mutex_lock(&f_lock);
+    bool join = f_running;
+    f_running = false;
+    for (unsigned g = 0; g < GPIO_MOCK_MAX_LINES; g++) lines[g].due_ns = 0;
+    if (join) pthread_cond_signal(&f_cond);
+    pthread_mutex_unlock(&f_lock);
+    if (join) {
+        pthread_join(f_thread, NULL);
+        pthread_cond_destroy(&f_cond);
+    }
+
+    pthread_mutex_lock(&q_lock);
+    if (q_fd >= 0) close(q_fd);
+    q_fd = -1;
+    q_head = q_tail = 0;
+    pthread_mutex_unlock(&q_lock);
+}
+
+void gpio_set_mode_input(unsigned gpio) { (void)gpio; }
+
+void gpio_set_pull(unsigned gpio, int pull)
+{
+    if (gpio >= GPIO_MOCK_MAX_LINES) return;
+    pthread_mutex_lock(&f_lock);
+    lines[gpio].level = lines[gpio].out = (pull == 1) ? 1 : 0;
+    pthread_mutex_unlock(&f_lock);
+}
+
+void gpio_set_glitch_filter(unsigned gpio, unsigned us)
+{
+    if (gpio >= GPIO_MOCK_MAX_LINES) return;
+    pthread_mutex_lock(&f_lock);
+    lines[gpio].filter_us = us;
+    if (!us) lines[gpio].out = lines[gpio].level;
+    pthread_mutex_unlock(&f_lock);
+}
+
+void gpio_set_alert(unsigned gpio, gpio_alert_cb cb, void *userdata)
+{
+    if (gpio >= GPIO_MOCK_MAX_LINES) return;
+    lines[gpio].cb   = cb;
+    lines[gpio].user = userdata;
+}
+
+int gpio_read_levels(const unsigned *gpios, unsigned n, int *levels)
+{
+    for (unsigned i = 0; i < n; i++) {
+        if (gpios[i] >= GPIO_MOCK_MAX_LINES) return -EINVAL;
+        const struct mock_line *l = &lines[gpios[i]];
+        levels[i] = (f_on && l->filter_us) ? l->out : l->level;
+    }
+    return 0;
+}
+
+int gpio_set_wakeup(unsigned gpio, int enable) { (void)gpio; (void)enable; return -ENOTSUP; }
+
+void gpio_delay_ms(unsigned ms)
+{
+    struct timespec ts = { (time_t)(ms / 1000u), (long)(ms % 1000u) * 1000000L };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+uint32_t gpio_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+int gpio_get_fd(void)
+{
+    pthread_mutex_lock(&q_lock);
+    if (q_fd < 0) q_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int fd = q_fd < 0 ? -errno : q_fd;
+    pthread_mutex_unlock(&q_lock);
+    return fd;
+}
+
+int gpio_dispatch(void)
+{
+    uint64_t cnt;
+    int n = 0;
+    if (q_fd < 0) return -EINVAL;
+    while (read(q_fd, &cnt, sizeof(cnt)) < 0 && errno == EINTR) {}
+    for (;;) {
+        pthread_mutex_lock(&q_lock);
+        if (q_head == q_tail) { pthread_mutex_unlock(&q_lock); break; }
+        struct mock_edge e = queue[q_head++ % GPIO_MOCK_QUEUE_LEN];
+        pthread_mutex_unlock(&q_lock);
+        struct mock_line *l = &lines[e.gpio];
+        if (l->cb) { l->cb((int)e.gpio, e.level, e.tick, l->user); n++; }
+    }
+    return n;
+}
+
+void gpio_mock_set_level(unsigned gpio, int level)
+{
+    if (gpio >= GPIO_MOCK_MAX_LINES) return;
+    struct mock_line *l = &lines[gpio];
+    if (l->level == level) return;
+    if (f_on && l->filter_us) {
+        pthread_mutex_lock(&f_lock);
+        l->level = level;
+        l->due_ns = mono_ns() + (uint64_t)l->filter_us * 1000u;   // restarts on every change
+        if (!f_running) {
+            pthread_condattr_t ca;
+            pthread_condattr_init(&ca);
+            pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+            pthread_cond_init(&f_cond, &ca);
+            pthread_condattr_destroy(&ca);
+            f_running = pthread_create(&f_thread, NULL, filter_main, NULL) == 0;
+        }
+        pthread_cond_signal(&f_cond);
+        pthread_mutex_unlock(&f_lock);
+        return;
+    }
+    l->level = level;
+    if (!l->cb) return;
+    deliver(gpio, level, (uint32_t)(mono_ns() / 1000u));
+}
+
+int gpio_mock_play(const btns_sig_edge_t *e, size_t n, unsigned first_gpio, uint64_t t0_ns)
+{
+    for (size_t i = 0; i < n; i++)
+        if (first_gpio + e[i].line >= GPIO_MOCK_MAX_LINES) return -EINVAL;
+    if (!t0_ns) t0_ns = mono_ns();
+    for (size_t i = 0; i < n; i++) {
+        uint64_t at = t0_ns + e[i].t_us * 1000u;
+        struct timespec ts = { (time_t)(at / 1000000000ull), (long)(at % 1000000000ull) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        gpio_mock_set_level(first_gpio + e[i].line, e[i].level);
+    }
+    return 0;
+}
+
+int gpio_mock_get_level(unsigned gpio)
+{
+    return gpio < GPIO_MOCK_MAX_LINES ? lines[gpio].level : -EINVAL;
+}
@@ -0,0 +1,40 @@
+#ifndef GPIO_MOCK_H
+#define GPIO_MOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gpio_backend.h"
+#include "btns_signal.h"
+
+#ifndef GPIO_MOCK_MAX_LINES
+#define GPIO_MOCK_MAX_LINES 1024
+#endif
+
+#ifndef GPIO_MOCK_QUEUE_LEN
+#define GPIO_MOCK_QUEUE_LEN 4096
+#endif
+
+// Simulated backend (gpio_mock.c): no hardware, the caller drives levels.
+// A level change invokes the registered alert synchronously on the caller's
+// thread; after gpio_get_fd() it is queued for gpio_dispatch() instead.
+void gpio_mock_set_level(unsigned gpio, int level);
+int  gpio_mock_get_level(unsigned gpio);   // raw level, before the filter
+
+// Emulate gpio_set_glitch_filter() (off by default: the filter is ignored and
+// every change is reported at once). On: a change is reported after the line
+// stayed stable for the filter period, from a mock thread, like the kernel's
+// debounce; gpio_read_levels() returns the filtered level.
+void gpio_mock_emulate_filter(bool on);
+
+// Sum the thread CPU time spent in synchronous alert callbacks, wherever they
+// run (caller, gpio_mock_play, filter thread); on resets the sum.
+void     gpio_mock_time_alerts(bool on);
+uint64_t gpio_mock_alert_cpu_ns(void);
+
+// Drive line first_gpio + e[i].line to e[i].level at t0_ns + e[i].t_us
+// (CLOCK_MONOTONIC, 0 = now), sleeping in between: a btns_signal_generate()
+// stream or a recorded trace in real time. -EINVAL if a line is out of range.
+int  gpio_mock_play(const btns_sig_edge_t *e, size_t n, unsigned first_gpio, uint64_t t0_ns);
+
+#endif